@@ -0,0 +1,62 @@
+#include "wwos/format.h"
+#include "wwos/stdint.h"
+#include "wwos/stdio.h"
+#include "wwos/syscall.h"
+#include "wwos/time.h"
+#include "wwos/vector.h"
+
+constexpr wwos::uint64_t TOTAL_SIZE = 16 << 20;
+
+// streams TOTAL_SIZE bytes through a FIFO to a forked reader, in writes of chunk
+// bytes, and returns the throughput in MB/s
+wwos::uint64_t measure(wwos::string_view path, wwos::vector<wwos::uint8_t>& buffer, wwos::uint64_t chunk) {
+    auto pid = wwos::fork();
+    if(pid == 0) {
+        auto fd = wwos::open(path, wwos::fd_mode::READONLY);
+        wwos::uint64_t total = 0;
+        while(total < TOTAL_SIZE) {
+            auto n = wwos::read(fd, buffer.data(), chunk);
+            if(n <= 0) {
+                break;
+            }
+            total += n;
+        }
+        wwos::close(fd);
+        wwos::exit(total == TOTAL_SIZE ? 0 : 1);
+    }
+
+    auto fd = wwos::open(path, wwos::fd_mode::WRITEONLY);
+    auto start = wwos::monotonic_time_ns();
+    wwos::uint64_t total = 0;
+    while(total < TOTAL_SIZE) {
+        auto n = wwos::write(fd, buffer.data(), chunk);
+        if(n < 0) {
+            break;
+        }
+        total += n;
+    }
+    wwos::close(fd);
+
+    wwos::int64_t status;
+    wwos::wait(pid, &status);
+    auto elapsed = wwos::monotonic_time_ns() - start;
+    if(status != 0) {
+        wwos::printf("reader failed with {}\n", status);
+    }
+    return elapsed > 0 ? TOTAL_SIZE * 1000 / elapsed : 0;
+}
+
+int main() {
+    auto path = wwos::format("/proc/{}/fifo/bench", wwos::get_pid());
+    if(wwos::create(path, wwos::fd_type::FIFO) < 0) {
+        wwos::printf("failed to create {}\n", path);
+        return 1;
+    }
+
+    constexpr wwos::uint64_t CHUNKS[] = { 64, 1024, 4096, 65536 };
+    wwos::vector<wwos::uint8_t> buffer(CHUNKS[3]);
+    for(auto chunk: CHUNKS) {
+        wwos::printf("{} byte writes: {} MB/s\n", chunk, measure(path, buffer, chunk));
+    }
+    return 0;
+}
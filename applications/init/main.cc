@@ -1,17 +1,24 @@
+#include "wwos/format.h"
 #include "wwos/stdint.h"
 #include "wwos/stdio.h"
 #include "wwos/syscall.h"
 
 
+// between attempts to start a tty that could not be spawned
+constexpr wwos::uint64_t RESPAWN_DELAY = 1000000;
+
 int main() {
-    wwos::uint32_t pid;
+    while(true) {
+        auto pid = wwos::spawn("/app/tty");
+        if(pid < 0) {
+            wwos::printf("init: failed to spawn /app/tty: {}\n", pid);
+            wwos::sleep(RESPAWN_DELAY);
+            continue;
+        }
 
-    pid = wwos::fork();
-    if(pid == 0) {
-        wwos::exec("/app/tty");
+        // sleeps until the tty exits, then starts a new one
+        wwos::wait(pid);
     }
 
-    while(true);
-
     return 0;
 }
\ No newline at end of file
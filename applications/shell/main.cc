@@ -326,103 +326,21 @@ void command_getpid(const wwos::vector<wwos::string>& args) {
 }
 
 void command_external(const wwos::string& cmd, const wwos::vector<wwos::string>& args) {
-    auto fid = wwos::open(cmd, wwos::fd_mode::READONLY);
-    if(fid < 0) {
-        wwos::println("Command not found");
-        return;
-    }
-
-    auto pid = wwos::fork();
+    // the command reads and writes the shell's own stdin / stdout, redirected or not
+    wwos::spawn_fd_action actions[] = {
+        { .child_fd = 0, .parent_fd = wwos::fd_stdin },
+        { .child_fd = 1, .parent_fd = wwos::fd_stdout },
+    };
 
+    auto pid = wwos::spawn(cmd, actions, 2);
     if(pid < 0) {
-        wwos::println("Failed to fork");
+        wwos::println("Command not found");
         return;
     }
 
-    if(pid == 0) {
-        auto exec_ret = wwos::exec(cmd);
-        if(exec_ret < 0) {
-            wwos::println("Failed to exec");
-        }
-        wwos::exit();
-    } else {
-    
-        wwos::string path_stdin = wwos::format("/proc/{}/fifo/stdin", pid);
-        wwos::string path_stdout = wwos::format("/proc/{}/fifo/stdout", pid);
-        wwos::cycle_queue<wwos::uint8_t> buffer_stdin(4000);
-
-        auto fd_stdin = wwos::open(path_stdin, wwos::fd_mode::WRITEONLY);
-        if(fd_stdin < 0) {
-            wwos::println("Failed to open stdin");
-            return;
-        }
-
-        auto fd_stdout = wwos::open(path_stdout, wwos::fd_mode::READONLY);
-        if(fd_stdout < 0) {
-            wwos::println("Failed to open stdout");
-            wwos::close(fd_stdin);
-            return;
-        }
-        
-        while(true) {
-            wwos::uint8_t buffer[128];
-
-            // read from shell stdin to buffer_stin
-            while(true) {
-                auto read_size = wwos::read(wwos::fd_stdin, buffer, sizeof(buffer));
-                if(read_size < 0) {
-                    wwos::println("Failed to read from stdin");
-                    break;
-                }
-                if(read_size == 0) {
-                    break;
-                }
-                for(wwos::int64_t i = 0; i < read_size; i++) {
-                    buffer_stdin.push(buffer[i]);
-                }
-            }
-
-            // write from buffer_stdin to shell stdin if possible
-            while(true) {
-                auto chunk_size = wwos::min(buffer_stdin.size(), sizeof(buffer));
-                if(chunk_size == 0) {
-                    break;
-                }
-                for(wwos::int64_t i = 0; i < chunk_size; i++) {
-                    buffer_stdin.pop(buffer[i]);
-                }
-                auto write_size = wwos::write(fd_stdin, buffer, chunk_size);
-                if(write_size <= 0) {
-                    break;
-                }
-                for(wwos::int64_t i = write_size; i < chunk_size; i++) {
-                    buffer_stdin.push_front(buffer[i]);
-                }
-            }
-
-
-            
-            auto size = wwos::read(fd_stdout, buffer, sizeof(buffer));
-            if(size < 0) {
-                wwos::println("Failed to read from child");
-                break;
-            }
-            if(size == 0) {
-                auto stat = wwos::tstat(pid);
-
-                if(stat == wwos::task_stat::TERMINATED || stat == wwos::task_stat::INVALID) {
-                    break;
-                }
-                wwos::sleep(1000);
-                continue;
-            }
-            for(wwos::int64_t i = 0; i < size; i++) {
-                wwos::putchar(buffer[i]);
-            }
-        }
-
-        wwos::close(fd_stdin);
-        wwos::close(fd_stdout);
+    wwos::int64_t status;
+    if(wwos::wait(pid, &status) == pid && status != 0) {
+        wwos::printf("exited with {}\n", status);
     }
 }
 
@@ -0,0 +1,64 @@
+#include "wwos/format.h"
+#include "wwos/io_ring.h"
+#include "wwos/stdint.h"
+#include "wwos/stdio.h"
+#include "wwos/string_view.h"
+#include "wwos/syscall.h"
+#include "wwos/time.h"
+
+constexpr wwos::uint64_t ITERATIONS = 100000;
+
+template<typename F>
+void measure(wwos::string_view name, F f) {
+    auto pid = wwos::get_pid();
+    wwos::task_usage before, after;
+    wwos::get_task_usage(pid, &before);
+    auto start = wwos::monotonic_time_ns();
+
+    f();
+
+    auto elapsed = wwos::monotonic_time_ns() - start;
+    wwos::get_task_usage(pid, &after);
+
+    auto user_time = after.user_time - before.user_time;
+    auto system_time = after.system_time - before.system_time;
+    auto total_time = user_time + system_time;
+
+    wwos::printf("{}: {} ops in {} us (user {} us, system {} us)\n", name, ITERATIONS, total_time, user_time, system_time);
+    wwos::printf("{}: {} ns per op, {} ns per op wall clock\n", name, total_time * 1000 / ITERATIONS, elapsed / ITERATIONS);
+}
+
+// round trip of the cheapest syscall, i.e. the cost of the trap path itself,
+// against the same number of no-ops batched through the io_ring, and against
+// reading the clock, which needs no trap at all
+int main() {
+    measure("clock", [] {
+        for(wwos::uint64_t i = 0; i < ITERATIONS; i++) {
+            wwos::monotonic_time_ns();
+        }
+    });
+
+    measure("syscall", [] {
+        for(wwos::uint64_t i = 0; i < ITERATIONS; i++) {
+            wwos::get_pid();
+        }
+    });
+
+    auto ring = wwos::io_ring_setup();
+    if(ring == nullptr) {
+        wwos::printf("failed to set up io_ring\n");
+        return 1;
+    }
+
+    measure("io_ring", [ring] {
+        wwos::io_completion cqe;
+        for(wwos::uint64_t i = 0; i < ITERATIONS; i += wwos::IO_RING_ENTRIES) {
+            for(wwos::uint64_t j = i; j < i + wwos::IO_RING_ENTRIES && j < ITERATIONS; j++) {
+                wwos::io_ring_submit(ring, { .user_data = j, .op = wwos::io_op::NOP });
+            }
+            wwos::io_ring_enter();
+            while(wwos::io_ring_complete(ring, &cqe)) {}
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include "wwos/format.h"
+#include "wwos/stdint.h"
+#include "wwos/stdio.h"
+#include "wwos/string.h"
+#include "wwos/syscall.h"
+#include "wwos/vector.h"
+
+
+constexpr wwos::uint64_t SAMPLE_INTERVAL = 1000000; // microseconds
+constexpr int SAMPLES = 5;
+
+struct task_sample {
+    wwos::uint64_t pid;
+    wwos::task_usage usage;
+};
+
+wwos::vector<task_sample> collect_samples() {
+    wwos::vector<task_sample> out;
+    for(wwos::uint64_t pid = 0; ; pid++) {
+        auto stat = wwos::tstat(pid);
+        if(stat == wwos::task_stat::INVALID) {
+            break;
+        }
+        if(stat == wwos::task_stat::TERMINATED) {
+            continue;
+        }
+
+        task_sample sample;
+        sample.pid = pid;
+        if(wwos::get_task_usage(pid, &sample.usage) < 0) {
+            continue;
+        }
+        out.push_back(sample);
+    }
+    return out;
+}
+
+wwos::string column(wwos::uint64_t value) {
+    return wwos::format("{}", value);
+}
+
+void print_samples(wwos::vector<task_sample>& previous, wwos::vector<task_sample>& current) {
+    wwos::printf("{:6l} {:6l} {:10l} {:10l} {:8l} {:8l} {:10l} {:10l}\n",
+        "PID", "CPU%", "USER(ms)", "SYS(ms)", "VCSW", "ICSW", "WAIT(ms)", "MAXLAT(us)");
+
+    for(auto& sample: current) {
+        auto& usage = sample.usage;
+        wwos::uint64_t cpu_time = usage.user_time + usage.system_time;
+
+        wwos::uint64_t previous_cpu_time = 0;
+        for(auto& p: previous) {
+            if(p.pid == sample.pid) {
+                previous_cpu_time = p.usage.user_time + p.usage.system_time;
+                break;
+            }
+        }
+
+        wwos::uint64_t percent = (cpu_time - previous_cpu_time) * 100 / SAMPLE_INTERVAL;
+
+        wwos::printf("{:6l} {:6l} {:10l} {:10l} {:8l} {:8l} {:10l} {:10l}\n",
+            column(sample.pid), column(percent),
+            column(usage.user_time / 1000), column(usage.system_time / 1000),
+            column(usage.voluntary_switches), column(usage.involuntary_switches),
+            column(usage.wait_time / 1000), column(usage.max_latency));
+    }
+    wwos::println("");
+}
+
+int main() {
+    auto previous = collect_samples();
+    for(int i = 0; i < SAMPLES; i++) {
+        wwos::sleep(SAMPLE_INTERVAL);
+        auto current = collect_samples();
+        print_samples(previous, current);
+        previous = current;
+    }
+    return 0;
+}
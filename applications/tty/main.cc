@@ -11,12 +11,27 @@
 
 wwos::int64_t current_tty = -1;
 
+// console output is collected here and handed to the kernel in one syscall
+wwos::vector<char> console_pending;
+
+void console_write(char c) {
+    console_pending.push_back(c);
+}
+
+void console_flush() {
+    if(console_pending.size() == 0) {
+        return;
+    }
+    wwos::kputchars(console_pending.data(), console_pending.size());
+    console_pending.clear();
+}
+
 class output_proxy {
 public:
     output_proxy(): m_buffer(1024) {}
 
     void write(wwos::uint8_t c) {
-        wwos::kputchar(c);
+        console_write(c);
         wwos::uint8_t buf;
         if(m_buffer.full()) m_buffer.pop(buf);
         m_buffer.push(c);
@@ -24,7 +39,7 @@ public:
 
     void rewrite() {
         for(auto c: m_buffer.items()) {
-            wwos::kputchar(c);
+            console_write(c);
         }
     }
 
@@ -54,12 +69,14 @@ struct tty_info {
 };
 
 constexpr wwos::size_t N_TTYS = 4;
+constexpr wwos::uint64_t TTY_RT_PRIORITY = 50;
 tty_info* ttys[N_TTYS + 1];
 wwos::size_t BUFFER_SIZE = 1 << 20;
 
 wwos::string tty_getline(output_proxy& proxy) {
     wwos::string out;
     while(true) {
+        console_flush();
         wwos::int32_t c = wwos::kgetchar();
         if(c == -1) {
             continue;
@@ -97,6 +114,7 @@ void initialize_tty_log() {
     };
 
     wwassert(ttys[N_TTYS]->fd_stdout >= 0, "Failed to open fifo");
+    wwos::set_nonblocking(ttys[N_TTYS]->fd_stdout);
 }
 
 void initialize_tty(wwos::size_t i) {
@@ -109,16 +127,13 @@ void initialize_tty(wwos::size_t i) {
         return;
     }
 
-    auto pid = wwos::fork();
+    // every session gets its own share of the cpu, however many jobs it runs
+    auto pid = wwos::spawn("/app/shell", nullptr, 0, wwos::SPAWN_NEW_SCHED_GROUP);
     if(pid < 0) {
-        wwassert(false, "Failed to fork");
+        wwassert(false, "Failed to spawn");
         return;
     }
 
-    if(pid == 0) {
-        wwos::exec("/app/shell");
-    }
-
     ttys[i] = new tty_info {
         .pid = pid,
         .fd_stdin = wwos::open(wwos::format("/proc/{}/fifo/stdin", pid), wwos::fd_mode::WRITEONLY),
@@ -129,6 +144,10 @@ void initialize_tty(wwos::size_t i) {
 
     wwassert(ttys[i]->fd_stdin >= 0, "Failed to open fifo");
     wwassert(ttys[i]->fd_stdout >= 0, "Failed to open fifo");
+
+    // the tty serves every session from one loop, it must never block on one of them
+    wwos::set_nonblocking(ttys[i]->fd_stdin);
+    wwos::set_nonblocking(ttys[i]->fd_stdout);
 }
 
 void switch_to_tty(wwos::int64_t i) {
@@ -143,17 +162,11 @@ void switch_to_tty(wwos::int64_t i) {
 }
 
 void clear_screen() {
-    wwos::kputchar(0x1b);
-    wwos::kputchar(0x5b);
-    wwos::kputchar(0x33);
-    wwos::kputchar(0x4a);
-    wwos::kputchar(0x1b);
-    wwos::kputchar(0x5b);
-    wwos::kputchar(0x48);
-    wwos::kputchar(0x1b);
-    wwos::kputchar(0x5b);
-    wwos::kputchar(0x32);
-    wwos::kputchar(0x4a);
+    // erase scrollback, cursor home, erase screen
+    const char sequence[] = "\x1b[3J\x1b[H\x1b[2J";
+    for(wwos::size_t i = 0; i + 1 < sizeof(sequence); i++) {
+        console_write(sequence[i]);
+    }
 }
 
 void command_mode(output_proxy& proxy) {
@@ -203,100 +216,120 @@ bool is_normal_characters(wwos::int32_t c) {
     return false;
 }
 
-int main() {
-    for(wwos::size_t i = 0; i < N_TTYS + 1; i++) {
-        ttys[i] = nullptr;
-    }
+output_proxy command_mode_proxy;
 
-    current_tty = -1;
-    switch_to_tty(N_TTYS);
-    switch_to_tty(0);
+void handle_key(wwos::int32_t c) {
+    if(c == 27) {
+        clear_screen();
+        command_mode(command_mode_proxy);
 
-    clear_screen();
+        clear_screen();
+        ttys[current_tty]->proxy.rewrite();
+        return;
+    }
 
-    output_proxy command_mode_proxy;
-    
-    while(true) {
-        auto c = wwos::kgetchar();
-        
-        if(c == 27) {
-            clear_screen();
-            command_mode(command_mode_proxy);
+    auto p_tty = ttys[current_tty];
+    if(current_tty == N_TTYS) {
+        return;
+    }
 
-            auto p_tty = ttys[current_tty];
+    if(c == 127) {
+        if(p_tty->buffer_line.size() > 0) {
+            p_tty->proxy.pop(1);
+            p_tty->buffer_line.pop_back();
             clear_screen();
             p_tty->proxy.rewrite();
-            continue;
         }
+    } else if(is_normal_characters(c) || c == 13) {
+        if(c == 13) c = 10;
 
+        p_tty->buffer_line.push_back(c);
+        p_tty->proxy.write(c);
 
-        auto p_tty = ttys[current_tty];
-
-        if(current_tty != N_TTYS) {
-            if(c == 127) {
-                if(p_tty->buffer_line.size() > 0) {
-                    p_tty->proxy.pop(1);
-                    p_tty->buffer_line.pop_back();
-                    clear_screen();
-                    p_tty->proxy.rewrite();
-                }
-            } else if(is_normal_characters(c) || c == 13) {
-                if(c == 13) c = 10;
-
-                p_tty->buffer_line.push_back(c);
-                p_tty->proxy.write(c);
-            
-
-                if(c == 10) {
-                    for(auto c: p_tty->buffer_line) {
-                        if(p_tty->buffer_stdin.full()) {
-                            wwos::uint8_t buf;
-                            p_tty->buffer_stdin.pop(buf);
-                        }
-                        p_tty->buffer_stdin.push(c);
-                    }
-                    p_tty->buffer_line.clear();
-                }
-            }
-            
-            while(true) {
-                wwos::uint8_t bufc;
-                bool succ = p_tty->buffer_stdin.get_front(bufc);
-                if(!succ) {
-                    break;
-                }
-                auto size = wwos::write(p_tty->fd_stdin, &bufc, 1);
-                if(size <= 0) {
-                    break;
+        if(c == 10) {
+            for(auto c: p_tty->buffer_line) {
+                if(p_tty->buffer_stdin.full()) {
+                    wwos::uint8_t buf;
+                    p_tty->buffer_stdin.pop(buf);
                 }
-                p_tty->buffer_stdin.pop(bufc);
+                p_tty->buffer_stdin.push(c);
             }
+            p_tty->buffer_line.clear();
         }
+    }
+}
 
-        for(wwos::size_t i = 0; i < N_TTYS + 1; i++) {
-            auto i_tty = ttys[i];
-            if(i_tty == nullptr) {
-                continue;
-            }
-        
-            char buffer[128];
-            while(true) {
-                auto size = wwos::read(i_tty->fd_stdout, (wwos::uint8_t*)buffer, sizeof(buffer));
-                
-                for(wwos::int64_t i = 0; i < size; i++) {
-                    if(i_tty->buffer_stdout.full()) {
-                        wwos::uint8_t buf;
-                        i_tty->buffer_stdout.pop(buf);
-                    }
-                    i_tty->buffer_stdout.push(buffer[i]);
-                }
+void flush_stdin(tty_info* p_tty) {
+    while(true) {
+        wwos::uint8_t bufc;
+        bool succ = p_tty->buffer_stdin.get_front(bufc);
+        if(!succ) {
+            break;
+        }
+        auto size = wwos::write(p_tty->fd_stdin, &bufc, 1);
+        if(size <= 0) {
+            break;
+        }
+        p_tty->buffer_stdin.pop(bufc);
+    }
+}
 
-                if(size < sizeof(buffer)) {
-                    break;
-                }
+// returns false once the session's shell is gone and its stdout reached end of file
+bool drain_stdout(tty_info* p_tty) {
+    char buffer[128];
+    while(true) {
+        auto size = wwos::read(p_tty->fd_stdout, (wwos::uint8_t*)buffer, sizeof(buffer));
+        if(size == 0) {
+            return false;
+        }
+
+        for(wwos::int64_t i = 0; i < size; i++) {
+            if(p_tty->buffer_stdout.full()) {
+                wwos::uint8_t buf;
+                p_tty->buffer_stdout.pop(buf);
             }
+            p_tty->buffer_stdout.push(buffer[i]);
         }
 
+        if(size < 0 || size < sizeof(buffer)) {
+            return true;
+        }
+    }
+}
+
+void restart_tty(wwos::size_t i) {
+    wwos::close(ttys[i]->fd_stdin);
+    wwos::close(ttys[i]->fd_stdout);
+    if(ttys[i]->pid > 0) {
+        wwos::wait(ttys[i]->pid);
+    }
+    delete ttys[i];
+    ttys[i] = nullptr;
+    initialize_tty(i);
+}
+
+int main() {
+    // keystrokes are echoed ahead of CFS load. the tty blocks in poll, and the
+    // sessions it spawns start out in CFS again
+    auto ret = wwos::set_scheduler(wwos::sched_policy::FIFO, TTY_RT_PRIORITY);
+    wwassert(ret == 0, "Failed to set tty scheduler");
+
+    for(wwos::size_t i = 0; i < N_TTYS + 1; i++) {
+        ttys[i] = nullptr;
+    }
+
+    current_tty = -1;
+    switch_to_tty(N_TTYS);
+    switch_to_tty(0);
+
+    auto fd_console = wwos::open("/dev/console", wwos::fd_mode::READONLY);
+    wwassert(fd_console >= 0, "Failed to open console");
+    wwos::set_nonblocking(fd_console);
+
+    clear_screen();
+
+    while(true) {
+        auto p_tty = ttys[current_tty];
         while(true) {
             wwos::uint8_t bufc;
             bool succ = p_tty->buffer_stdout.get_front(bufc);
@@ -306,6 +339,41 @@ int main() {
             p_tty->proxy.write(bufc);
             p_tty->buffer_stdout.pop(bufc);
         }
+        console_flush();
+
+        // sleep until a key is pressed, a session prints, or a session accepts pending input
+        wwos::poll_fd fds[2 * (N_TTYS + 1) + 1];
+        wwos::size_t n_fds = 0;
+        fds[n_fds++] = { .fd = fd_console, .events = wwos::POLL_READABLE };
+        for(wwos::size_t i = 0; i < N_TTYS + 1; i++) {
+            if(ttys[i] == nullptr) {
+                continue;
+            }
+            fds[n_fds++] = { .fd = ttys[i]->fd_stdout, .events = wwos::POLL_READABLE };
+            if(ttys[i]->fd_stdin >= 0 && ttys[i]->buffer_stdin.size() > 0) {
+                fds[n_fds++] = { .fd = ttys[i]->fd_stdin, .events = wwos::POLL_WRITABLE };
+            }
+        }
+        wwos::poll(fds, n_fds);
+
+        // one key at a time: escape hands the console over to command mode
+        wwos::uint8_t key;
+        while(wwos::read(fd_console, &key, 1) == 1) {
+            handle_key(key);
+        }
+
+        for(wwos::size_t i = 0; i < N_TTYS + 1; i++) {
+            if(ttys[i] == nullptr) {
+                continue;
+            }
+            if(!drain_stdout(ttys[i])) {
+                restart_tty(i);
+                continue;
+            }
+            if(ttys[i]->fd_stdin >= 0) {
+                flush_stdin(ttys[i]);
+            }
+        }
     }
     return 0;
 }
\ No newline at end of file
@@ -8,8 +8,12 @@ namespace wwos {
     constexpr uint64_t USERSPACE_TEXT          __attribute__((unused)) = 0x200000;
     constexpr uint64_t USERSPACE_STACK_BOTTOM  __attribute__((unused)) = 0x200000000;
     constexpr uint64_t USERSPACE_STACK_TOP     __attribute__((unused)) = 0x240000000;
+    constexpr uint64_t USERSPACE_IO_RING       __attribute__((unused)) = 0x300000000;  // one page
+    constexpr uint64_t USERSPACE_TIME_PAGE     __attribute__((unused)) = 0x300001000;  // read-only
     constexpr uint64_t USERSPACE_HEAP          __attribute__((unused)) = 0x400000000;  // 16 GB
-    constexpr uint64_t USERSPACE_HEAP_END      __attribute__((unused)) = 0x2000000000; // 128 GB
+    constexpr uint64_t USERSPACE_HEAP_END      __attribute__((unused)) = 0x1000000000; // 64 GB
+    constexpr uint64_t USERSPACE_SHARED        __attribute__((unused)) = 0x1000000000; // shared memory mappings
+    constexpr uint64_t USERSPACE_SHARED_END    __attribute__((unused)) = 0x2000000000; // 128 GB
     constexpr uint64_t USERSPACE_END           __attribute__((unused)) = 0x2000000000; // 128 GB
 
     constexpr uint64_t KERNEL_STACK_SIZE       __attribute__((unused)) = 0x1 << 20; // 1 MB
@@ -0,0 +1,211 @@
+#ifndef _WWOS_HASH_MAP_H
+#define _WWOS_HASH_MAP_H
+
+#include "wwos/assert.h"
+#include "wwos/pair.h"
+#include "wwos/stdint.h"
+#include "wwos/string.h"
+#include "wwos/vector.h"
+
+namespace wwos {
+
+// murmur3's finalizer: every input bit affects every output bit
+inline uint64_t hash_integer(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+template <typename K>
+struct hash {
+    uint64_t operator()(const K& key) const {
+        return hash_integer(static_cast<uint64_t>(key));
+    }
+};
+
+// fnv-1a over the bytes, then the integer finalizer for the low bits
+inline uint64_t hash_bytes(const void* data, size_t size) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    uint64_t h = 0xcbf29ce484222325ull;
+    for(size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash_integer(h);
+}
+
+template <>
+struct hash<string> {
+    uint64_t operator()(const string& key) const {
+        return hash_bytes(key.c_str(), key.size());
+    }
+};
+
+template <typename K, typename V>
+struct hash_map_node {
+    K key;
+    V value;
+    hash_map_node* next;
+};
+
+// separate chaining over a power of two number of buckets, grown once there
+// are more entries than buckets. same interface as map, without the order
+template <typename K, typename V, typename H = hash<K>>
+class hash_map {
+public:
+    hash_map() {
+        reset_buckets(INITIAL_BUCKETS);
+    }
+
+    ~hash_map() {
+        clear();
+    }
+
+    hash_map(const hash_map& other) {
+        reset_buckets(INITIAL_BUCKETS);
+        for(auto& item: other.items()) {
+            insert(item.first, item.second);
+        }
+    }
+
+    hash_map& operator=(const hash_map& other) {
+        if(this == &other) {
+            return *this;
+        }
+        clear();
+        for(auto& item: other.items()) {
+            insert(item.first, item.second);
+        }
+        return *this;
+    }
+
+    // key must not be present yet: that is left to the caller, so that an
+    // insert is a single probe. returns the stored value
+    V& insert(const K& key, const V& value) {
+        if(m_size >= m_buckets.size()) {
+            rehash(m_buckets.size() * 2);
+        }
+        auto& bucket = m_buckets[index_of(key)];
+        bucket = new hash_map_node<K, V>{key, value, bucket};
+        m_size++;
+        return bucket->value;
+    }
+
+    void update(const K& key, const V& value) {
+        get(key) = value;
+    }
+
+    void remove(const K& key) {
+        auto link = &m_buckets[index_of(key)];
+        while(*link != nullptr && !((*link)->key == key)) {
+            link = &(*link)->next;
+        }
+        wwassert(*link != nullptr, "key not found");
+        auto node = *link;
+        *link = node->next;
+        delete node;
+        m_size--;
+    }
+
+    // nullptr if key is not present. one lookup, where contains + get take two
+    V* find(const K& key) {
+        for(auto node = m_buckets[index_of(key)]; node != nullptr; node = node->next) {
+            if(node->key == key) {
+                return &node->value;
+            }
+        }
+        return nullptr;
+    }
+
+    // the same, by a Q that H hashes like the K it compares equal to. finds
+    // e.g. a string key by a view of it, without building the key
+    template <typename Q>
+    V* find_as(const Q& key) {
+        for(auto node = m_buckets[index_of(key)]; node != nullptr; node = node->next) {
+            if(node->key == key) {
+                return &node->value;
+            }
+        }
+        return nullptr;
+    }
+
+    V& get(const K& key) {
+        auto value = find(key);
+        wwassert(value != nullptr, "key not found");
+        return *value;
+    }
+
+    bool contains(const K& key) {
+        return find(key) != nullptr;
+    }
+
+    vector<pair<K, V>> items() const {
+        vector<pair<K, V>> result;
+        for(size_t i = 0; i < m_buckets.size(); i++) {
+            for(auto node = m_buckets[i]; node != nullptr; node = node->next) {
+                result.push_back({node->key, node->value});
+            }
+        }
+        return result;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    void clear() {
+        for(size_t i = 0; i < m_buckets.size(); i++) {
+            auto node = m_buckets[i];
+            while(node != nullptr) {
+                auto next = node->next;
+                delete node;
+                node = next;
+            }
+            m_buckets[i] = nullptr;
+        }
+        m_size = 0;
+    }
+
+private:
+    constexpr static size_t INITIAL_BUCKETS = 16;
+
+    template <typename Q>
+    size_t index_of(const Q& key) const {
+        return H()(key) & (m_buckets.size() - 1);
+    }
+
+    void reset_buckets(size_t count) {
+        m_buckets = vector<hash_map_node<K, V>*>(count);
+        for(size_t i = 0; i < count; i++) {
+            m_buckets[i] = nullptr;
+        }
+    }
+
+    void rehash(size_t count) {
+        auto old_buckets = move(m_buckets);
+        reset_buckets(count);
+        for(size_t i = 0; i < old_buckets.size(); i++) {
+            auto node = old_buckets[i];
+            while(node != nullptr) {
+                auto next = node->next;
+                auto& bucket = m_buckets[index_of(node->key)];
+                node->next = bucket;
+                bucket = node;
+                node = next;
+            }
+        }
+    }
+
+    vector<hash_map_node<K, V>*> m_buckets;
+    size_t m_size = 0;
+};
+
+}
+
+#endif
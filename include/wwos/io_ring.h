@@ -0,0 +1,74 @@
+#ifndef _WWOS_IO_RING_H
+#define _WWOS_IO_RING_H
+
+#include "wwos/stdint.h"
+
+namespace wwos {
+
+    enum class io_op: uint32_t {
+        NOP,
+        READ,       // fd, addr = buffer, size
+        WRITE,      // fd, addr = buffer, size
+        OPEN,       // addr = path, size = path length, flags = fd_mode
+        CLOSE,      // fd
+        POLL,       // addr = poll_fd array, size = count. completes once one is ready
+    };
+
+    struct io_submission {
+        uint64_t user_data;     // copied into the completion
+        io_op op;
+        uint32_t flags;
+        int64_t fd;
+        uint64_t addr;
+        uint64_t size;
+    };
+
+    struct io_completion {
+        uint64_t user_data;
+        int64_t result;         // what the matching syscall would have returned
+    };
+
+    constexpr size_t IO_RING_ENTRIES = 64;
+
+    // one page shared between a task and the kernel. the task produces submissions
+    // and consumes completions, the kernel the other way around. heads and tails
+    // count up forever, an entry lives at index % IO_RING_ENTRIES.
+    // submissions are picked up whenever the task enters the kernel: any syscall,
+    // interrupt or timer tick. an op that would block stays in flight, it never
+    // completes with FD_WOULD_BLOCK. at most IO_RING_ENTRIES ops are in flight or
+    // waiting to be consumed, further submissions wait in the ring.
+    struct io_ring {
+        uint32_t sq_head;       // written by the kernel
+        uint32_t sq_tail;       // written by the task
+        uint32_t cq_head;       // written by the task
+        uint32_t cq_tail;       // written by the kernel
+        io_submission sq[IO_RING_ENTRIES];
+        io_completion cq[IO_RING_ENTRIES];
+    };
+
+    static_assert(sizeof(io_ring) <= 4096, "io_ring must fit in a page");
+
+    // false if the submission queue is full
+    inline bool io_ring_submit(io_ring* ring, const io_submission& sqe) {
+        auto tail = ring->sq_tail;
+        if(tail - __atomic_load_n(&ring->sq_head, __ATOMIC_ACQUIRE) >= IO_RING_ENTRIES) {
+            return false;
+        }
+        ring->sq[tail % IO_RING_ENTRIES] = sqe;
+        __atomic_store_n(&ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // false if no completion is waiting
+    inline bool io_ring_complete(io_ring* ring, io_completion* cqe) {
+        auto head = ring->cq_head;
+        if(head == __atomic_load_n(&ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        *cqe = ring->cq[head % IO_RING_ENTRIES];
+        __atomic_store_n(&ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+}
+
+#endif
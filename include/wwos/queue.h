@@ -1,6 +1,8 @@
 #ifndef _WWOS_QUEUE_H
 #define _WWOS_QUEUE_H
 
+#include "wwos/algorithm.h"
+#include "wwos/alloc.h"
 #include "wwos/stdint.h"
 #include "wwos/vector.h"
 namespace wwos {
@@ -20,6 +22,30 @@ public:
         return true;
     }
 
+    // as much of data as fits, in at most two copies. returns how much that was
+    size_t push(const T* data, size_t count) {
+        static_assert(__is_trivially_copyable(T), "bulk push copies raw memory");
+        count = min(count, m_data.size() - m_size);
+        auto first = min(count, m_data.size() - m_tail);
+        memcpy(m_data.data() + m_tail, data, first * sizeof(T));
+        memcpy(m_data.data(), data + first, (count - first) * sizeof(T));
+        m_tail = (m_tail + count) % m_data.size();
+        m_size += count;
+        return count;
+    }
+
+    // up to count elements, in at most two copies. returns how many there were
+    size_t pop(T* out, size_t count) {
+        static_assert(__is_trivially_copyable(T), "bulk pop copies raw memory");
+        count = min(count, m_size);
+        auto first = min(count, m_data.size() - m_head);
+        memcpy(out, m_data.data() + m_head, first * sizeof(T));
+        memcpy(out + first, m_data.data(), (count - first) * sizeof(T));
+        m_head = (m_head + count) % m_data.size();
+        m_size -= count;
+        return count;
+    }
+
     bool push_front(const T& data) {
         if(m_size == m_data.size()) {
             return false;
@@ -87,6 +113,147 @@ protected:
     size_t m_size = 0;
 };
 
+// where a segmented_queue takes its segments from: SIZE bytes each, nullptr
+// when there is no memory left
+template <size_t SIZE>
+struct heap_segment_allocator {
+    static void* allocate() {
+        return new uint8_t[SIZE];
+    }
+
+    static void free(void* segment) {
+        delete[] static_cast<uint8_t*>(segment);
+    }
+};
+
+// a queue of trivially copyable elements kept in a chain of page sized
+// segments, allocated as elements arrive and freed as they drain: an empty
+// queue holds no storage at all. at most capacity elements are queued
+template <typename T, size_t SEGMENT_SIZE = 4096, typename A = heap_segment_allocator<SEGMENT_SIZE>>
+class segmented_queue {
+public:
+    segmented_queue(size_t capacity): m_capacity(capacity) {}
+
+    segmented_queue(const segmented_queue&) = delete;
+    segmented_queue& operator=(const segmented_queue&) = delete;
+
+    ~segmented_queue() {
+        clear();
+    }
+
+    // as much of data as fits, and as there is memory for. returns how much
+    // that was
+    size_t push(const T* data, size_t count) {
+        static_assert(__is_trivially_copyable(T), "segmented queue copies raw memory");
+        count = min(count, space());
+        size_t done = 0;
+        while(done < count) {
+            if(m_tail == nullptr || m_tail_index == PER_SEGMENT) {
+                auto s = static_cast<segment*>(A::allocate());
+                if(s == nullptr) {
+                    break;
+                }
+                s->next = nullptr;
+                if(m_tail == nullptr) {
+                    m_head = s;
+                    m_head_index = 0;
+                } else {
+                    m_tail->next = s;
+                }
+                m_tail = s;
+                m_tail_index = 0;
+            }
+            auto n = min(count - done, PER_SEGMENT - m_tail_index);
+            memcpy(m_tail->data + m_tail_index, data + done, n * sizeof(T));
+            m_tail_index += n;
+            done += n;
+        }
+        m_size += done;
+        return done;
+    }
+
+    // up to count elements. returns how many there were
+    size_t pop(T* out, size_t count) {
+        static_assert(__is_trivially_copyable(T), "segmented queue copies raw memory");
+        count = min(count, m_size);
+        size_t done = 0;
+        while(done < count) {
+            auto end = m_head == m_tail ? m_tail_index : PER_SEGMENT;
+            auto n = min(count - done, end - m_head_index);
+            memcpy(out + done, m_head->data + m_head_index, n * sizeof(T));
+            m_head_index += n;
+            done += n;
+            if(m_head_index == end) {
+                drop_head();
+            }
+        }
+        m_size -= count;
+        return count;
+    }
+
+    void clear() {
+        while(m_head != nullptr) {
+            drop_head();
+        }
+        m_size = 0;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+
+    // lowering it below size() keeps what is queued, but nothing more fits
+    // until enough has been popped
+    void set_capacity(size_t capacity) {
+        m_capacity = capacity;
+    }
+
+    size_t space() const {
+        return m_size < m_capacity ? m_capacity - m_size : 0;
+    }
+
+    // segments currently allocated
+    size_t segments() const {
+        size_t count = 0;
+        for(auto s = m_head; s != nullptr; s = s->next) {
+            count++;
+        }
+        return count;
+    }
+
+private:
+    constexpr static size_t PER_SEGMENT = (SEGMENT_SIZE - sizeof(void*)) / sizeof(T);
+    static_assert(PER_SEGMENT > 0, "segment too small for one element");
+
+    struct segment {
+        segment* next;
+        T data[PER_SEGMENT];
+    };
+    static_assert(sizeof(segment) <= SEGMENT_SIZE, "segment larger than an allocation");
+
+    // the head segment is drained: free it, and reset to empty with the last one
+    void drop_head() {
+        auto next = m_head->next;
+        A::free(m_head);
+        m_head = next;
+        m_head_index = 0;
+        if(m_head == nullptr) {
+            m_tail = nullptr;
+            m_tail_index = 0;
+        }
+    }
+
+    segment* m_head = nullptr;
+    segment* m_tail = nullptr;
+    size_t m_head_index = 0;    // next element to pop, in m_head
+    size_t m_tail_index = 0;    // next slot to push to, in m_tail
+    size_t m_size = 0;
+    size_t m_capacity;
+};
 
 };
 
@@ -9,7 +9,7 @@
 #include "wwos/syscall.h"
 
 #ifdef WWOS_KERNEL
-    namespace wwos::kernel { extern void kputchar(char c); }
+    namespace wwos::kernel { extern void kputchar(char c); extern void kputchars(const char* s, size_t n); }
 #endif
 
 namespace wwos {
@@ -37,8 +37,22 @@ namespace wwos {
 #endif
     }
 
-    inline int32_t kgetchar() {
-        int32_t c = syscall(syscall_id::GETCHAR, 0);
+    // writes a whole buffer to the console with a single syscall
+    inline void kputchars(const char* s, size_t n) {
+#ifdef WWOS_KERNEL
+        kernel::kputchars(s, n);
+#elif defined(WWOS_HOST)
+        for(size_t i = 0; i < n; i++) {
+            std::putchar(s[i]);
+        }
+#else
+        syscall(syscall_id::CONSOLE_WRITE, reinterpret_cast<uint64_t>(s), n);
+#endif
+    }
+
+    // reads the console. blocks until a key is pressed unless nonblocking
+    inline int32_t kgetchar(bool nonblocking = false) {
+        int32_t c = syscall(syscall_id::GETCHAR, nonblocking);
         if(c <= 1) return -1;
         else return c;
     }
@@ -66,12 +80,12 @@ namespace wwos {
 #ifdef WWOS_HOST
         return std::getchar();
 #else
-        int32_t c;
-        do {
-            uint64_t size = wwos::read(fd_stdin, (uint8_t*)&c, 1);
-            wwassert(size >= 0, "Failed to read from stdin");
-            if(size == 1) return c;
-        } while(true);
+        // blocks until a character arrives, -1 at end of file
+        uint8_t c;
+        int64_t size = wwos::read(fd_stdin, &c, 1);
+        wwassert(size >= 0, "Failed to read from stdin");
+        if(size == 0) return -1;
+        return c;
 #endif
     }
 #endif
@@ -0,0 +1,60 @@
+#ifndef _WWOS_SYNC_H
+#define _WWOS_SYNC_H
+
+#include "wwos/stdint.h"
+
+namespace wwos {
+
+    // the uncontended paths are a single compare-and-swap and never trap. the
+    // kernel is only entered to sleep in wait_on_address, or to wake a sleeper.
+    // all of them may live in memory shared between tasks.
+
+    class mutex {
+    public:
+        mutex() = default;
+        mutex(const mutex&) = delete;
+        mutex& operator=(const mutex&) = delete;
+
+        void lock();
+        bool try_lock();
+        void unlock();
+
+    private:
+        // 0: unlocked, 1: locked, 2: locked and someone may be sleeping on it
+        uint32_t state = 0;
+    };
+
+    class semaphore {
+    public:
+        semaphore(uint32_t count = 0): count(count) {}
+        semaphore(const semaphore&) = delete;
+        semaphore& operator=(const semaphore&) = delete;
+
+        void wait();
+        bool try_wait();
+        void signal();
+
+    private:
+        uint32_t count;
+        uint32_t sleepers = 0;
+    };
+
+    class condition_variable {
+    public:
+        condition_variable() = default;
+        condition_variable(const condition_variable&) = delete;
+        condition_variable& operator=(const condition_variable&) = delete;
+
+        // m must be locked. it is unlocked while sleeping and locked again before
+        // returning. wakeups may be spurious: wait in a loop on the condition
+        void wait(mutex& m);
+        void notify_one();
+        void notify_all();
+
+    private:
+        uint32_t sequence = 0;      // bumped by every notify
+        uint32_t sleepers = 0;
+    };
+}
+
+#endif
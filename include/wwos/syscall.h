@@ -3,6 +3,7 @@
 
 #include "wwos/algorithm.h"
 #include "wwos/assert.h"
+#include "wwos/io_ring.h"
 #include "wwos/pair.h"
 #include "wwos/stdint.h"
 #include "wwos/string_view.h"
@@ -29,68 +30,176 @@ namespace wwos {
         TERMINATED
     };
 
+    enum class sched_policy: uint64_t {
+        NORMAL,         // CFS, weighted by set_priority
+        FIFO,           // real-time, runs until it blocks or a higher rt priority is runnable
+        ROUND_ROBIN     // real-time, like FIFO but rotates among equal rt priorities
+    };
+
+    // child fd child_fd starts as a copy of the caller's parent_fd
+    struct spawn_fd_action {
+        int64_t child_fd;
+        int64_t parent_fd;
+    };
+
+    constexpr size_t SPAWN_MAX_FD_ACTIONS = 8;
+
+    // spawn flags
+    constexpr uint64_t SPAWN_NEW_SCHED_GROUP = 1 << 0;   // the child gets its own CFS group
+
+    constexpr uint64_t RT_PRIORITY_MIN = 1;
+    constexpr uint64_t RT_PRIORITY_MAX = 99;
+
+    // all times in microseconds
+    struct task_usage {
+        uint64_t user_time;
+        uint64_t system_time;
+        uint64_t voluntary_switches;    // left the cpu because it blocked or exited
+        uint64_t involuntary_switches;  // preempted while still runnable
+        uint64_t wait_time;             // total time spent runnable but not running
+        uint64_t max_latency;           // longest single wait between becoming runnable and running
+        uint64_t wakeup_latency;        // wait after the most recent wakeup
+        uint64_t max_wakeup_latency;
+    };
+
     struct fd_stat {
         uint64_t size;
         fd_type type;
     };
 
-    enum class syscall_id: uint64_t {
-        // io
-        PUTCHAR,
-        GETCHAR,
-
-        // memory
-        ALLOC,
-
-        // process
-        FORK,
-        EXEC,
-        EXIT,
-        GET_PID,
-        TASK_STAT,
-        SET_PRIORITY,
-
-        // semaphore
-        SEMAPHORE_CREATE, 
-        SEMAPHORE_SIGNAL,
-        SEMAPHORE_SIGNAL_AFTER_MICROSECONDS,
-        SEMAPHORE_WAIT,
-        SEMAPHORE_DESTROY,
-
-        // file system
-        FD_OPEN,        // path, mode           -> fd / <0
-        FD_CLOSE,       // fd                   -> 0 / <0
-        FD_CREATE,      // path, type           -> 0 / <0
-        FD_CHILDREN,    // fd, buffer, size     -> extra size required / 0 / <0
-        FD_READ,        // fd, buffer, size     -> write size / <0
-        FD_WRITE,       // fd, buffer, size     -> read size / <0
-        FD_SEEK,        // fd, offset           -> 0 / <0
-        FD_STAT,        // fd, &stat            -> 0 / <0
+    enum class fd_control: uint64_t {
+        SET_NONBLOCKING,    // value: 0 / 1
+        SET_FIFO_CAPACITY,  // value: bytes, 1 - FIFO_MAX_CAPACITY. FIFO only
+    };
+
+    // bytes a FIFO buffers before writes block, unless changed with SET_FIFO_CAPACITY
+    constexpr uint64_t FIFO_DEFAULT_CAPACITY = 1 << 20;
+    constexpr uint64_t FIFO_MAX_CAPACITY = 64 << 20;
+
+    // returned by read / write on a non-blocking fd that would otherwise block
+    constexpr int64_t FD_WOULD_BLOCK = -5;
+
+    // poll events
+    constexpr uint64_t POLL_READABLE = 1 << 0;  // a read would not block
+    constexpr uint64_t POLL_WRITABLE = 1 << 1;  // a write would not block
+    constexpr uint64_t POLL_HANGUP   = 1 << 2;  // the other end of the FIFO is gone. always reported
+    constexpr uint64_t POLL_INVALID  = 1 << 3;  // not an open fd. always reported
+
+    constexpr size_t POLL_MAX_FDS = 64;
+
+    struct poll_fd {
+        int64_t fd;
+        uint64_t events;    // what to wait for
+        uint64_t revents;   // what happened, filled in by poll
     };
 
-    inline uint64_t syscall(syscall_id id, uint64_t arg) {
-        uint64_t ret;
-        asm volatile(R"(
-            MOV x10, %1;
-            MOV x11, %2;
-            SVC #0;
-            MOV %0, x0;
-        )": "=r"(ret) : "r"(id), "r"(arg) : "x10", "x11", "x0");
+    // message queue limits. a message of whole, page aligned heap pages moves its
+    // frames to the receiver instead of being copied
+    constexpr size_t MQ_MAX_MESSAGES = 256;
+    constexpr size_t MQ_MAX_MESSAGE_SIZE = 1 << 20;
+
+    // message queue flags
+    constexpr uint64_t MQ_NONBLOCK = 1 << 0;   // FD_WOULD_BLOCK instead of blocking
+
+    // every syscall in number order, with its arguments and result. the kernel's
+    // dispatch table is generated from the same list
+#define WWOS_SYSCALLS(X) \
+    /* io */ \
+    X(PUTCHAR)              /* char */ \
+    X(GETCHAR)              /* nonblocking          -> char / -1 if nonblocking and no input */ \
+    X(CONSOLE_WRITE)        /* buffer, size         -> size / <0 */ \
+    \
+    /* memory */ \
+    X(ALLOC)                /* va                   -> 1 / 0 */ \
+    \
+    /* process */ \
+    X(FORK)                 /*                      -> child pid in the parent, 0 in the child / <0 */ \
+    X(EXEC)                 /* path                 -> only returns on failure, <0 */ \
+    X(SPAWN)                /* path, fd actions, count, flags -> pid / <0 */ \
+    X(EXIT)                 /* code */ \
+    X(WAIT)                 /* pid / -1 for any child, &status -> pid / <0 */ \
+    X(GET_PID)              /*                      -> pid */ \
+    X(TASK_STAT)            /* pid                  -> task_stat */ \
+    X(TASK_USAGE)           /* pid, &usage          -> 0 / <0 */ \
+    X(SET_PRIORITY)         /* priority             -> 0 */ \
+    X(SET_SCHEDULER)        /* policy, rt priority  -> 0 / <0 */ \
+    X(SCHED_GROUP_CREATE)   /* weight               -> group id / <0 */ \
+    \
+    /* semaphore */ \
+    X(SEMAPHORE_CREATE)     /* count                -> id */ \
+    X(SEMAPHORE_SIGNAL)     /* id, count            -> 0 / <0 */ \
+    X(SEMAPHORE_SIGNAL_AFTER_MICROSECONDS) /* id, microseconds -> 0 / <0 */ \
+    X(SEMAPHORE_WAIT)       /* id                   -> 0 / <0 */ \
+    X(SEMAPHORE_DESTROY)    /* id                   -> 0 / <0 */ \
+    \
+    /* message queue */ \
+    X(MQ_CREATE)            /* max messages, max message size -> id / <0 */ \
+    X(MQ_DESTROY)           /* id                   -> 0 / <0 */ \
+    X(MQ_SEND)              /* id, buffer, size, priority, flags -> 0 / <0 */ \
+    X(MQ_RECEIVE)           /* id, buffer, size, &priority, flags -> message size / <0 */ \
+    \
+    /* shared memory */ \
+    X(SHM_CREATE)           /* name / 0, size, va   -> id / <0 */ \
+    X(SHM_OPEN)             /* name                 -> id / <0 */ \
+    X(SHM_MAP)              /* id, va               -> size / <0 */ \
+    X(SHM_UNMAP)            /* va                   -> 0 / <0 */ \
+    \
+    /* futex */ \
+    X(WAIT_ON_ADDRESS)      /* addr, expected       -> 0 once woken / -2 if *addr != expected / <0 */ \
+    X(WAKE_ADDRESS)         /* addr, count          -> woken count / <0 */ \
+    \
+    /* file system */ \
+    X(FD_OPEN)              /* path, mode           -> fd / <0 */ \
+    X(FD_CLOSE)             /* fd                   -> 0 / <0 */ \
+    X(FD_CREATE)            /* path, type           -> 0 / <0 */ \
+    X(FD_CHILDREN)          /* fd, buffer, size     -> extra size required / 0 / <0 */ \
+    X(FD_READ)              /* fd, buffer, size     -> read size / <0 */ \
+    X(FD_WRITE)             /* fd, buffer, size     -> write size / <0 */ \
+    X(FD_SEEK)              /* fd, offset           -> 0 / <0 */ \
+    X(FD_STAT)              /* fd, &stat            -> 0 / <0 */ \
+    X(FD_CONTROL)           /* fd, op, value        -> 0 / <0 */ \
+    X(POLL)                 /* fds, count, timeout  -> ready count / 0 on timeout / <0 */ \
+    X(IO_RING_SETUP)        /*                      -> ring va / <0 */ \
+    X(IO_RING_ENTER)        /* min complete         -> completions waiting / <0 */
+
+    enum class syscall_id: uint64_t {
+#define WWOS_SYSCALL_ID(name) name,
+        WWOS_SYSCALLS(WWOS_SYSCALL_ID)
+#undef WWOS_SYSCALL_ID
+        COUNT
+    };
 
-        return ret;
+    // up to six arguments in x0 - x5 and the number in x8, the result comes back
+    // in x0. every other register is preserved
+    inline uint64_t syscall(syscall_id id, uint64_t arg0 = 0, uint64_t arg1 = 0, uint64_t arg2 = 0,
+                            uint64_t arg3 = 0, uint64_t arg4 = 0, uint64_t arg5 = 0) {
+        register uint64_t x0 asm("x0") = arg0;
+        register uint64_t x1 asm("x1") = arg1;
+        register uint64_t x2 asm("x2") = arg2;
+        register uint64_t x3 asm("x3") = arg3;
+        register uint64_t x4 asm("x4") = arg4;
+        register uint64_t x5 asm("x5") = arg5;
+        register uint64_t x8 asm("x8") = static_cast<uint64_t>(id);
+        asm volatile("SVC #0"
+            : "+r"(x0)
+            : "r"(x1), "r"(x2), "r"(x3), "r"(x4), "r"(x5), "r"(x8)
+            : "memory");
+
+        return x0;
     }
 
     inline uint64_t semaphore_create(int64_t count) {
         return syscall(syscall_id::SEMAPHORE_CREATE, count);
     }
 
-    inline int64_t semaphore_signal(int64_t id) {
-        return syscall(syscall_id::SEMAPHORE_SIGNAL, id);
+    // releases count waiters at once, oldest first. what is left over is added
+    // to the semaphore
+    inline int64_t semaphore_signal(int64_t id, uint64_t count = 1) {
+        return syscall(syscall_id::SEMAPHORE_SIGNAL, id, count);
     }
 
     inline int64_t semaphore_signal_after_microseconds(int64_t id, uint64_t microseconds) {
-        uint64_t params[] = {(uint64_t)id, microseconds};
-        return syscall(syscall_id::SEMAPHORE_SIGNAL_AFTER_MICROSECONDS, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::SEMAPHORE_SIGNAL_AFTER_MICROSECONDS, id, microseconds);
     }
 
     inline int64_t semaphore_wait(int64_t id) {
@@ -101,6 +210,58 @@ namespace wwos {
         return syscall(syscall_id::SEMAPHORE_DESTROY, id);
     }    
 
+    inline int64_t mq_create(size_t max_messages, size_t max_message_size) {
+        return syscall(syscall_id::MQ_CREATE, max_messages, max_message_size);
+    }
+
+    inline int64_t mq_destroy(int64_t id) {
+        return syscall(syscall_id::MQ_DESTROY, id);
+    }
+
+    // blocks while the queue is full. if buffer is whole, page aligned heap
+    // pages, they are handed over and the caller is left with zeroed pages
+    inline int64_t mq_send(int64_t id, void* buffer, size_t size, uint64_t priority = 0, uint64_t flags = 0) {
+        return syscall(syscall_id::MQ_SEND, id, reinterpret_cast<uint64_t>(buffer), size, priority, flags);
+    }
+
+    // blocks while the queue is empty. takes the highest priority message, the
+    // oldest among equals. fails with -3 and leaves it queued if size is too small
+    inline int64_t mq_receive(int64_t id, void* buffer, size_t size, uint64_t* priority = nullptr, uint64_t flags = 0) {
+        return syscall(syscall_id::MQ_RECEIVE, id, reinterpret_cast<uint64_t>(buffer), size, reinterpret_cast<uint64_t>(priority), flags);
+    }
+
+    // shared memory is mapped between USERSPACE_SHARED and USERSPACE_SHARED_END,
+    // at a page aligned va chosen by the caller. an object lives as long as some
+    // task maps it: unmap, exit and exec drop a mapping, fork shares it.
+    // an empty name creates an anonymous object, mapped by id only
+    inline int64_t shm_create(string_view name, size_t size, void* va) {
+        return syscall(syscall_id::SHM_CREATE, name.size() > 0 ? reinterpret_cast<uint64_t>(name.data()) : 0, size, reinterpret_cast<uint64_t>(va));
+    }
+
+    inline int64_t shm_open(string_view name) {
+        return syscall(syscall_id::SHM_OPEN, reinterpret_cast<uint64_t>(name.data()));
+    }
+
+    inline int64_t shm_map(int64_t id, void* va) {
+        return syscall(syscall_id::SHM_MAP, id, reinterpret_cast<uint64_t>(va));
+    }
+
+    inline int64_t shm_unmap(void* va) {
+        return syscall(syscall_id::SHM_UNMAP, reinterpret_cast<uint64_t>(va));
+    }
+
+    // blocks while the 32-bit word at addr holds expected, until a wake_address on
+    // the same word. the word is identified by its physical address, so tasks
+    // sharing the page can wait on it through different mappings
+    inline int64_t wait_on_address(uint32_t* addr, uint32_t expected) {
+        return syscall(syscall_id::WAIT_ON_ADDRESS, reinterpret_cast<uint64_t>(addr), expected);
+    }
+
+    // wakes up to count tasks waiting on addr, oldest first
+    inline int64_t wake_address(uint32_t* addr, uint64_t count) {
+        return syscall(syscall_id::WAKE_ADDRESS, reinterpret_cast<uint64_t>(addr), count);
+    }
+
     inline int64_t fork() {
         return syscall(syscall_id::FORK, 0);
     }
@@ -113,36 +274,69 @@ namespace wwos {
         return syscall(syscall_id::EXEC, reinterpret_cast<uint64_t>(path.data()));
     }
 
+    // starts the program at path as a new child. the child gets only the fds
+    // listed in actions, and its runtime opens /proc/<pid>/fifo for a missing
+    // stdin / stdout. much cheaper than fork + exec, the caller is not copied
+    inline int64_t spawn(string_view path, spawn_fd_action* actions = nullptr, size_t count = 0, uint64_t flags = 0) {
+        return syscall(syscall_id::SPAWN, reinterpret_cast<uint64_t>(path.data()), reinterpret_cast<uint64_t>(actions), count, flags);
+    }
+
     inline int64_t open(string_view path, fd_mode mode) {
-        uint64_t params[] = {reinterpret_cast<uint64_t>(path.data()), static_cast<uint64_t>(mode)};
-        return syscall(syscall_id::FD_OPEN, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::FD_OPEN, reinterpret_cast<uint64_t>(path.data()), static_cast<uint64_t>(mode));
     }
 
     inline int64_t create(string_view path, fd_type type) {
-        uint64_t params[] = {reinterpret_cast<uint64_t>(path.data()), static_cast<uint64_t>(type)};
-        return syscall(syscall_id::FD_CREATE, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::FD_CREATE, reinterpret_cast<uint64_t>(path.data()), static_cast<uint64_t>(type));
     }
 
     int64_t get_children(int64_t fd, vector<string>& buffer);
 
     inline int64_t read(int64_t fd, uint8_t* buffer, size_t size) {
-        uint64_t params[] = {static_cast<uint64_t>(fd), reinterpret_cast<uint64_t>(buffer), size};
-        return syscall(syscall_id::FD_READ, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::FD_READ, fd, reinterpret_cast<uint64_t>(buffer), size);
     }
 
     inline int64_t write(int64_t fd, uint8_t* buffer, size_t size) {
-        uint64_t params[] = {static_cast<uint64_t>(fd), reinterpret_cast<uint64_t>(buffer), size};
-        return syscall(syscall_id::FD_WRITE, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::FD_WRITE, fd, reinterpret_cast<uint64_t>(buffer), size);
     }
 
     inline int64_t seek(int64_t fd, size_t offset) {
-        uint64_t params[] = {static_cast<uint64_t>(fd), offset};
-        return syscall(syscall_id::FD_SEEK, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::FD_SEEK, fd, offset);
     }
 
     inline int64_t stat(int64_t fd, fd_stat* s) {
-        uint64_t params[] = {static_cast<uint64_t>(fd), reinterpret_cast<uint64_t>(s)};
-        return syscall(syscall_id::FD_STAT, reinterpret_cast<uint64_t>(params));
+        return syscall(syscall_id::FD_STAT, fd, reinterpret_cast<uint64_t>(s));
+    }
+
+    // reads from an empty FIFO and writes to a full one block, unless the fd is
+    // non-blocking: then they return FD_WOULD_BLOCK. an empty FIFO whose writers
+    // all closed reads as end of file (0).
+    inline int64_t set_nonblocking(int64_t fd, bool nonblocking = true) {
+        return syscall(syscall_id::FD_CONTROL, fd, static_cast<uint64_t>(fd_control::SET_NONBLOCKING), nonblocking);
+    }
+
+    // shared by every fd open on the FIFO. lowering it below what is buffered
+    // only makes writes wait until readers drained the excess
+    inline int64_t set_fifo_capacity(int64_t fd, uint64_t capacity) {
+        return syscall(syscall_id::FD_CONTROL, fd, static_cast<uint64_t>(fd_control::SET_FIFO_CAPACITY), capacity);
+    }
+
+    // waits until one of the fds is ready or the timeout (in microseconds) passes.
+    // a negative timeout waits forever, zero only checks.
+    inline int64_t poll(poll_fd* fds, size_t count, int64_t timeout = -1) {
+        return syscall(syscall_id::POLL, reinterpret_cast<uint64_t>(fds), count, timeout);
+    }
+
+    // maps the calling task's io_ring at USERSPACE_IO_RING. not inherited by
+    // forked children or across exec
+    inline io_ring* io_ring_setup() {
+        auto va = static_cast<int64_t>(syscall(syscall_id::IO_RING_SETUP));
+        return va < 0 ? nullptr : reinterpret_cast<io_ring*>(va);
+    }
+
+    // picks up new submissions, then blocks until at least min_complete
+    // completions are waiting or nothing is left in flight
+    inline int64_t io_ring_enter(size_t min_complete = 0) {
+        return syscall(syscall_id::IO_RING_ENTER, min_complete);
     }
 
     inline int64_t close(int64_t fd) {
@@ -165,18 +359,39 @@ namespace wwos {
         return semaphore_wait(semaphore);
     }
 
-    [[noreturn]] inline void exit() {
-        syscall(syscall_id::EXIT, 0);
+    [[noreturn]] inline void exit(int64_t code = 0) {
+        syscall(syscall_id::EXIT, code);
         __builtin_unreachable();
     }
 
+    // blocks until the child pid (any child if -1) exits, then collects its exit
+    // code. children nobody waits for are kept around until their parent exits.
+    inline int64_t wait(int64_t pid, int64_t* status = nullptr) {
+        return syscall(syscall_id::WAIT, pid, reinterpret_cast<uint64_t>(status));
+    }
+
     inline task_stat tstat(uint64_t pid) {
         return static_cast<task_stat>(syscall(syscall_id::TASK_STAT, pid));
     }
 
+    inline int64_t get_task_usage(uint64_t pid, task_usage* usage) {
+        return syscall(syscall_id::TASK_USAGE, pid, reinterpret_cast<uint64_t>(usage));
+    }
+
     inline int64_t set_priority(uint64_t priority) {
         return syscall(syscall_id::SET_PRIORITY, priority);
     }
+
+    // real-time policies are not inherited by forked children
+    inline int64_t set_scheduler(sched_policy policy, uint64_t rt_priority = 0) {
+        return syscall(syscall_id::SET_SCHEDULER, static_cast<uint64_t>(policy), rt_priority);
+    }
+
+    // moves the calling task into a new scheduling group. children forked afterwards
+    // inherit it, and the group as a whole gets a CFS share proportional to weight.
+    inline int64_t create_sched_group(uint64_t weight = 1000) {
+        return syscall(syscall_id::SCHED_GROUP_CREATE, weight);
+    }
 }
 
 #endif
\ No newline at end of file
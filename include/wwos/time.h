@@ -0,0 +1,33 @@
+#ifndef _WWOS_TIME_H
+#define _WWOS_TIME_H
+
+#include "wwos/defs.h"
+#include "wwos/stdint.h"
+
+namespace wwos {
+
+    // filled in once at boot and mapped read-only at USERSPACE_TIME_PAGE in every
+    // task. nanoseconds since boot = ((CNTVCT_EL0 - boot_counter) * mult) >> shift
+    struct time_page {
+        uint64_t frequency;     // CNTFRQ_EL0, in Hz
+        uint64_t mult;
+        uint64_t shift;
+        uint64_t boot_counter;  // CNTVCT_EL0 at boot
+    };
+
+    inline uint64_t counter_to_ns(const time_page& page, uint64_t counter) {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(counter - page.boot_counter) * page.mult) >> page.shift);
+    }
+
+#ifdef WWOS_APPLICATION
+    // reads the counter directly, no syscall
+    inline uint64_t monotonic_time_ns() {
+        auto page = reinterpret_cast<const time_page*>(USERSPACE_TIME_PAGE);
+        uint64_t counter;
+        asm volatile("ISB; MRS %0, CNTVCT_EL0" : "=r"(counter) : : "memory");
+        return counter_to_ns(*page, counter);
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include "wwos/stdint.h"
+
+#include "../smp.h"
+
+#include "cpu.h"
+
+extern "C" void wwos_secondary_entry();
+
+namespace wwos::kernel {
+
+constexpr uint64_t PSCI_CPU_ON = 0xC4000003;
+constexpr uint64_t PSCI_AFFINITY_INFO = 0xC4000004;
+
+// read by wwos_secondary_entry (start.s) before the mmu is on, keep the layout in sync
+struct secondary_boot_block {
+    uint64_t mair;
+    uint64_t tcr;
+    uint64_t ttbr0;
+    uint64_t ttbr1;
+    uint64_t sctlr;
+    uint64_t stack_top;
+    uint64_t entry;
+    uint64_t cpu_id;
+};
+
+// a secondary cpu turns on the mmu while still executing at the physical address,
+// so ttbr0 identity-maps the address space with 1GB blocks, the same way the loader does.
+static uint64_t identity_table[512] __attribute__((aligned(4096)));
+static secondary_boot_block boot_blocks[MAX_CPUS];
+
+static uint64_t kernel_va_to_pa(const void* va) {
+    return reinterpret_cast<uint64_t>(va) - KA_BEGIN;
+}
+
+size_t get_cpu_id() {
+    uint64_t mpidr;
+    asm volatile("MRS %0, MPIDR_EL1" : "=r"(mpidr));
+    return mpidr & 0xff;
+}
+
+static int64_t psci_call(uint64_t function, uint64_t arg0, uint64_t arg1, uint64_t arg2) {
+    register uint64_t x0 asm("x0") = function;
+    register uint64_t x1 asm("x1") = arg0;
+    register uint64_t x2 asm("x2") = arg1;
+    register uint64_t x3 asm("x3") = arg2;
+    asm volatile("HVC #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3) : "memory");
+    return static_cast<int64_t>(x0);
+}
+
+bool cpu_present(size_t cpu_id) {
+    // PSCI answers INVALID_PARAMETERS for cpus the machine does not have
+    return psci_call(PSCI_AFFINITY_INFO, cpu_id, 0, 0) >= 0;
+}
+
+int64_t start_cpu(size_t cpu_id, uint64_t stack_top, void (*entry)(uint64_t)) {
+    if(identity_table[0] == 0) {
+        for(uint64_t i = 0; i < 512; i++) {
+            identity_table[i] = i << 30 | 0x1 | (1 << 10);
+        }
+    }
+
+    auto& block = boot_blocks[cpu_id];
+    asm volatile("MRS %0, MAIR_EL1" : "=r"(block.mair));
+    asm volatile("MRS %0, TCR_EL1" : "=r"(block.tcr));
+    asm volatile("MRS %0, TTBR1_EL1" : "=r"(block.ttbr1));
+    asm volatile("MRS %0, SCTLR_EL1" : "=r"(block.sctlr));
+    block.ttbr0 = kernel_va_to_pa(identity_table);
+    block.stack_top = stack_top;
+    block.entry = reinterpret_cast<uint64_t>(entry);
+    block.cpu_id = cpu_id;
+    asm volatile("DSB SY");
+
+    return psci_call(PSCI_CPU_ON, cpu_id, kernel_va_to_pa(reinterpret_cast<void*>(&wwos_secondary_entry)), kernel_va_to_pa(&block));
+}
+
+[[noreturn]] void switch_stack(uint64_t stack_top, void (*entry)()) {
+    asm volatile(R"(
+        MOV SP, %0
+        BR  %1
+    )" : : "r"(stack_top), "r"(entry));
+    __builtin_unreachable();
+}
+
+void wait_for_interrupt() {
+    asm volatile("DSB SY; WFI" ::: "memory");
+}
+
+}
@@ -0,0 +1,24 @@
+#ifndef _WWOS_KERNEL_AARCH64_CPU_H
+#define _WWOS_KERNEL_AARCH64_CPU_H
+
+#include "wwos/stdint.h"
+
+namespace wwos::kernel {
+
+size_t get_cpu_id();
+bool cpu_present(size_t cpu_id);
+
+// powers on a secondary cpu through PSCI CPU_ON. it enables the mmu with the same
+// settings as the calling cpu and jumps to entry(cpu_id) on the given stack.
+// returns 0 on success, the (negative) PSCI error code otherwise.
+int64_t start_cpu(size_t cpu_id, uint64_t stack_top, void (*entry)(uint64_t));
+
+[[noreturn]] void switch_stack(uint64_t stack_top, void (*entry)());
+
+// waits with interrupts masked. a pending interrupt still wakes the cpu up,
+// it is then acknowledged by the caller.
+void wait_for_interrupt();
+
+}
+
+#endif
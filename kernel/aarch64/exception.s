@@ -26,9 +26,9 @@ protect_and_handle_exception:
     MRS     x0, SP_EL0;
     STR     x0, [sp, #0x108]
     
-    MOV     x0, x10;
-    MOV     x1, x11;
-    MOV     x2, sp;
+    // syscall number and arguments are read back from the saved frame
+    MOV     x0, sp;
+    MOV     x1, x3;
     B       wwos_aarch64_handle_exception;
 
 
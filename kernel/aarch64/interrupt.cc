@@ -7,15 +7,18 @@
 #include "wwos/syscall.h"
 
 #include "../drivers/gic2.h"
+#include "../io_ring.h"
+#include "../logging.h"
 #include "../syscall.h"
 #include "../process.h"
+#include "../smp.h"
 
 #include "interrupt.h"
 
-namespace wwos::kernel { [[noreturn]] void internal_wwos_aarch64_handle_exception(uint64_t arg0, uint64_t arg1, uint64_t p_sp, uint64_t source); }
+namespace wwos::kernel { [[noreturn]] void internal_wwos_aarch64_handle_exception(uint64_t p_sp, uint64_t source); }
 
-extern "C" [[noreturn]] void wwos_aarch64_handle_exception(wwos::uint64_t arg0, wwos::uint64_t arg1, wwos::uint64_t p_sp, wwos::uint64_t source) {
-    wwos::kernel::internal_wwos_aarch64_handle_exception(arg0, arg1, p_sp, source);
+extern "C" [[noreturn]] void wwos_aarch64_handle_exception(wwos::uint64_t p_sp, wwos::uint64_t source) {
+    wwos::kernel::internal_wwos_aarch64_handle_exception(p_sp, source);
 }
 
 namespace wwos::kernel {
@@ -56,116 +59,54 @@ void setup_interrupt() {
     return;
 }
 
-void save_process_info(uint64_t p_sp) {
-    auto& task = get_current_task();
-    uint64_t* p = reinterpret_cast<uint64_t*>(p_sp);
-
-    for(size_t i = 0; i < 31; i++) {
-        task.pcb.state.registers[i] = p[i];
-    }
-
-    task.pcb.state.spsr = p[31];
-    task.pcb.pc = p[32];
-    task.pcb.usp = p[33];
-
-    task.pcb.has_return_value = false;
-    task.pcb.return_value = 0xdeadbeef;
-}
-
-[[noreturn]] void eret_to_unprivileged(uint64_t addr, uint64_t sp_user, uint64_t sp_kernel, process_state state, bool withret, uint64_t ret){
-    asm volatile("MSR SPSR_EL1, %0" : : "r"(state.spsr));
-    asm volatile("MSR ELR_EL1, %0" : : "r"(addr));
-    asm volatile("MSR SP_EL0, %0" : : "r"(sp_user));
-
-    
-    if(withret) {
-        asm volatile(R"(
-            MOV SP, %1
-
-            MOV x0,  %2
-            MOV x1,  %0
-            LDR x2,  [x1, #16]
-            LDR x3,  [x1, #24]
-            LDR x4,  [x1, #32]
-            LDR x5,  [x1, #40]
-            LDR x6,  [x1, #48]
-            LDR x7,  [x1, #56]
-            LDR x8,  [x1, #64]
-            LDR x9,  [x1, #72]
-            LDR x10, [x1, #80]
-            LDR x11, [x1, #88]
-            LDR x12, [x1, #96]
-            LDR x13, [x1, #104]
-            LDR x14, [x1, #112]
-            LDR x15, [x1, #120]
-            LDR x16, [x1, #128]
-            LDR x17, [x1, #136]
-            LDR x18, [x1, #144]
-            LDR x19, [x1, #152]
-            LDR x20, [x1, #160]
-            LDR x21, [x1, #168]
-            LDR x22, [x1, #176]
-            LDR x23, [x1, #184]
-            LDR x24, [x1, #192]
-            LDR x25, [x1, #200]
-            LDR x26, [x1, #208]
-            LDR x27, [x1, #216]
-            LDR x28, [x1, #224]
-            LDR x29, [x1, #232]
-            LDR x30, [x1, #240]
-            LDR x1,  [x1, #8]
-            ERET
-        )" : : "r"(&state.registers), "r"(sp_kernel), "r"(ret): "x0", "x1");
-
-    } else {
-        asm volatile(R"(
-            MOV SP, %1
-
-            MOV x0, %0
-            LDR x1, [x0, #8]
-            LDR x2, [x0, #16]
-            LDR x3, [x0, #24]
-            LDR x4, [x0, #32]
-            LDR x5, [x0, #40]
-            LDR x6, [x0, #48]
-            LDR x7, [x0, #56]
-            LDR x8, [x0, #64]
-            LDR x9, [x0, #72]
-            LDR x10, [x0, #80]
-            LDR x11, [x0, #88]
-            LDR x12, [x0, #96]
-            LDR x13, [x0, #104]
-            LDR x14, [x0, #112]
-            LDR x15, [x0, #120]
-            LDR x16, [x0, #128]
-            LDR x17, [x0, #136]
-            LDR x18, [x0, #144]
-            LDR x19, [x0, #152]
-            LDR x20, [x0, #160]
-            LDR x21, [x0, #168]
-            LDR x22, [x0, #176]
-            LDR x23, [x0, #184]
-            LDR x24, [x0, #192]
-            LDR x25, [x0, #200]
-            LDR x26, [x0, #208]
-            LDR x27, [x0, #216]
-            LDR x28, [x0, #224]
-            LDR x29, [x0, #232]
-            LDR x30, [x0, #240]
-            LDR x0, [x0, #0]
-            ERET
-        )" : : "r"(&state.registers), "r"(sp_kernel): "x0");
-    }
+[[noreturn]] void eret_to_unprivileged(uint64_t sp_kernel) {
+    // the lock is released once SP is off the kernel stack of the task that trapped:
+    // another cpu may pick that task up right away. the frame restored afterwards
+    // belongs to the task about to run here, which no other cpu touches.
+    asm volatile(R"(
+        MOV SP, %0
+        SUB x0, SP, #0x110
+
+        LDP x1, x2, [x0, #0xF8]
+        MSR SPSR_EL1, x1
+        MSR ELR_EL1, x2
+        LDR x1, [x0, #0x108]
+        MSR SP_EL0, x1
+
+        STLRB WZR, [%1]
+
+        LDP x2, x3, [x0, #0x10]
+        LDP x4, x5, [x0, #0x20]
+        LDP x6, x7, [x0, #0x30]
+        LDP x8, x9, [x0, #0x40]
+        LDP x10, x11, [x0, #0x50]
+        LDP x12, x13, [x0, #0x60]
+        LDP x14, x15, [x0, #0x70]
+        LDP x16, x17, [x0, #0x80]
+        LDP x18, x19, [x0, #0x90]
+        LDP x20, x21, [x0, #0xA0]
+        LDP x22, x23, [x0, #0xB0]
+        LDP x24, x25, [x0, #0xC0]
+        LDP x26, x27, [x0, #0xD0]
+        LDP x28, x29, [x0, #0xE0]
+        LDR x30, [x0, #0xF0]
+        LDP x0, x1, [x0, #0x00]
+        ERET
+    )" : : "r"(sp_kernel), "r"(g_kernel_lock.raw()): "x0", "x1", "x2", "memory");
     __builtin_unreachable();
 }
 
 gic02_driver* g_interrupt_controller;
 
+constexpr size_t TIMER_IRQ = 30;
+constexpr size_t RESCHEDULE_SGI = 0;
+constexpr size_t UART_IRQ = WWOS_UART_IRQ;
+constexpr size_t ICFGR_LEVEL = 0;
+constexpr size_t ICFGR_EDGE = 2;
+
 void initialize_timer() {
     constexpr size_t GICD_BASE_VA = WWOS_GICD_BASE + KA_BEGIN;
     constexpr size_t GICC_BASE_VA = WWOS_GICC_BASE + KA_BEGIN;
-    constexpr size_t TIMER_IRQ = 30;
-    constexpr size_t ICFGR_EDGE = 2;
 
     g_interrupt_controller = new gic02_driver(GICD_BASE_VA, GICC_BASE_VA);
     g_interrupt_controller->initialize();
@@ -174,10 +115,60 @@ void initialize_timer() {
     g_interrupt_controller->set_priority(TIMER_IRQ, 0);
     g_interrupt_controller->clear(TIMER_IRQ);
     g_interrupt_controller->enable(TIMER_IRQ);
+    g_interrupt_controller->set_priority(RESCHEDULE_SGI, 0);
+    g_interrupt_controller->enable(RESCHEDULE_SGI);
 
     return;
 }
 
+// the cpu interface and the private timer interrupt are banked, every cpu sets up its own
+void initialize_secondary_timer() {
+    g_interrupt_controller->initialize_cpu_interface();
+    g_interrupt_controller->set_config(TIMER_IRQ, ICFGR_EDGE);
+    g_interrupt_controller->set_priority(TIMER_IRQ, 0);
+    g_interrupt_controller->clear(TIMER_IRQ);
+    g_interrupt_controller->enable(TIMER_IRQ);
+    g_interrupt_controller->set_priority(RESCHEDULE_SGI, 0);
+    g_interrupt_controller->enable(RESCHEDULE_SGI);
+}
+
+// the uart raises a level-triggered interrupt on cpu 0 while input is waiting
+void initialize_uart_interrupt() {
+    g_interrupt_controller->set_config(UART_IRQ, ICFGR_LEVEL);
+    g_interrupt_controller->set_core(UART_IRQ, 0);
+    g_interrupt_controller->set_priority(UART_IRQ, 0);
+    g_interrupt_controller->enable(UART_IRQ);
+}
+
+void send_reschedule_interrupt(size_t cpu) {
+    g_interrupt_controller->send_sgi(RESCHEDULE_SGI, cpu);
+}
+
+// device interrupts are completed after the device was serviced, so that a level
+// triggered line is low again by then. the timer is left to the caller.
+static void handle_device_interrupt(uint32_t interrupt_id) {
+    if(interrupt_id == UART_IRQ) {
+        on_console_interrupt();
+    } else if((interrupt_id & 0x3ff) == RESCHEDULE_SGI) {
+        // nothing to do: the woken task is found by the next schedule.
+        // the IAR of an SGI carries the sender in bits 10 - 12
+    } else {
+        wwassert(false, "Unknown interrupt");
+    }
+    g_interrupt_controller->finish_interrupt(interrupt_id);
+}
+
+void acknowledge_interrupts() {
+    uint32_t interrupt_id;
+    while((interrupt_id = g_interrupt_controller->get_interrupt_id()) != 1023) {
+        if(interrupt_id == TIMER_IRQ) {
+            g_interrupt_controller->finish_interrupt(interrupt_id);
+        } else {
+            handle_device_interrupt(interrupt_id);
+        }
+    }
+}
+
 void set_timeout_interrupt(uint64_t microsecond) {
     size_t freq;
     asm volatile("MRS      %0, CNTFRQ_EL0" : "=r"(freq));
@@ -201,11 +192,11 @@ void disable_irq() {
     asm volatile( "MSR DAIFSET, #0b0010" );
 }
 
-
-constexpr size_t TIMER_IRQ = 30;
-
-[[noreturn]] void internal_wwos_aarch64_handle_exception(uint64_t arg0, uint64_t arg1, uint64_t p_sp, uint64_t source) {    
-    save_process_info(p_sp);
+[[noreturn]] void internal_wwos_aarch64_handle_exception(uint64_t p_sp, uint64_t source) {    
+    g_kernel_lock.lock();
+    // nothing is copied: the frame exception.s pushed stays the task's saved state
+    wwassert(p_sp == reinterpret_cast<uint64_t>(&get_current_task().pcb.frame()), "trap frame not at the top of the kernel stack");
+    account_trap_entry(get_current_task());
 
     auto ec_bits = get_ec_bits();
 
@@ -213,16 +204,19 @@ constexpr size_t TIMER_IRQ = 30;
     
     // {
     //     auto current_task = get_current_task();
-    //     wwfmtlog("Exception. ELR={:x}, SP={:x} ARG0={:x} ARG1={:x} SOURCE={:x}, EC={:x}", current_task.pcb.pc, current_task.pcb.usp, arg0, arg1, source, ec_bits);
+    //     wwfmtlog("Exception. ELR={:x}, SP={:x} X8={:x} SOURCE={:x}, EC={:x}", current_task.pcb.frame().elr, current_task.pcb.frame().sp_el0, current_task.pcb.frame().registers[8], source, ec_bits);
     // }
 
+    // the io_ring is drained while the trapping task's tables are still active.
+    // not on a data abort, which a ring buffer itself may be waiting on
     if(source % 4 == 1) {
+        drain_io_ring(get_current_task());
         if(g_interrupt_controller && ((interrupt_id = g_interrupt_controller->get_interrupt_id()) != 1023)) {
-            g_interrupt_controller->finish_interrupt(interrupt_id);
             if(interrupt_id == TIMER_IRQ) {
+                g_interrupt_controller->finish_interrupt(interrupt_id);
                 on_timeout();
             } else {
-                wwassert(false, "Unknown interrupt");
+                handle_device_interrupt(interrupt_id);
             }
         }
     } else {
@@ -231,7 +225,8 @@ constexpr size_t TIMER_IRQ = 30;
         } else if(ec_bits <= 0b010000) {
             wwassert(false, "Trap: not supported yet");
         } else if(ec_bits == 0b010001 || ec_bits == 0b010101) {
-            receive_syscall(static_cast<syscall_id>(arg0), arg1);
+            drain_io_ring(get_current_task());
+            receive_syscall(get_current_task().pcb.frame());
         } else if(ec_bits == 0b100100 || ec_bits == 0b100101) {
             auto far = get_far_el1();
             on_data_abort(far);
@@ -240,13 +235,15 @@ constexpr size_t TIMER_IRQ = 30;
         }
     }
 
+    preempt_if_needed();
+
     auto& current_task = get_current_task();
     current_task.pcb.tt.activate();
+    account_trap_exit(current_task);
 #ifdef WWOS_LOG_ERET
-    wwfmtlog("ret?={}, ret_value={}", current_task.pcb.has_return_value, current_task.pcb.return_value);
-    wwfmtlog("eret to unprivileged. pid={}, pc={:x} usp={:x}", current_task.pid, current_task.pcb.pc, current_task.pcb.usp);
+    wwfmtlog("eret to unprivileged. pid={}, x0={:x}, pc={:x} usp={:x}", current_task.pid, current_task.pcb.frame().registers[0], current_task.pcb.frame().elr, current_task.pcb.frame().sp_el0);
 #endif
-    eret_to_unprivileged(current_task.pcb.pc, current_task.pcb.usp, current_task.pcb.ksp, current_task.pcb.state, current_task.pcb.has_return_value, current_task.pcb.return_value);
+    eret_to_unprivileged(current_task.pcb.ksp);
 }
 
 
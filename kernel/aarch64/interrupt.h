@@ -4,17 +4,29 @@
 #include "wwos/stdint.h"
 namespace wwos::kernel {
 
-struct process_state {
-    uint64_t spsr = 0;
+// pushed by exception.s on every trap. for a task it sits right below the top of
+// its kernel stack and is the only copy of its user state while it is not running
+struct trap_frame {
     uint64_t registers[31] = {0};
+    uint64_t spsr = 0;
+    uint64_t elr = 0;
+    uint64_t sp_el0 = 0;
 };
 
+static_assert(sizeof(trap_frame) == 0x110, "must match exception.s");
+
 void setup_interrupt();
 
-[[noreturn]] void eret_to_unprivileged(uint64_t addr, uint64_t sp_user, uint64_t sp_kernel, process_state state, bool withret = false, uint64_t ret = 0);
+// restores the trap frame right below sp_kernel and returns to userspace
+[[noreturn]] void eret_to_unprivileged(uint64_t sp_kernel);
 
 void initialize_timer();
+void initialize_secondary_timer();
+void initialize_uart_interrupt();
+void acknowledge_interrupts();
 void set_timeout_interrupt(uint64_t microsecond);
+// wakes cpu from wait_for_interrupt, it looks for work on its way out
+void send_reschedule_interrupt(size_t cpu);
 void enable_irq();
 void disable_irq();
 
@@ -54,7 +54,7 @@ static_assert(sizeof(page_descriptor) == 8, "page_descriptor size is not 8 bytes
 
 
 template <translation_table_regime regime>
-void translation_table<regime>::set_page(uint64_t va, uint64_t pa, uint64_t level, uint64_t* level_items){
+void translation_table<regime>::set_page(uint64_t va, uint64_t pa, bool readonly, uint64_t level, uint64_t* level_items){
     if(level_items == nullptr) {
         level_items = items;
     }
@@ -69,7 +69,7 @@ void translation_table<regime>::set_page(uint64_t va, uint64_t pa, uint64_t leve
         page.sh = 0b11;
 
         if constexpr (regime == translation_table_regime::USER) {
-            page.ap = 0b01; // 0b11: read/write
+            page.ap = readonly ? 0b11 : 0b01; // 0b01: read/write, 0b11: read-only
         }
     } else {
         if((level_items[index] & 0x1) == 0) {
@@ -83,7 +83,7 @@ void translation_table<regime>::set_page(uint64_t va, uint64_t pa, uint64_t leve
         }
         auto& table = reinterpret_cast<table_descriptor&>(level_items[index]);
         auto next_level_items = reinterpret_cast<uint64_t*>((table.next_level_table_addr << 12) + KA_BEGIN);
-        set_page(va, pa, level + 1, next_level_items);
+        set_page(va, pa, readonly, level + 1, next_level_items);
     }
 }
 
@@ -116,6 +116,50 @@ vector<pair<uint64_t, uint64_t>> translation_table<regime>::get_all_pages() {
     return pages;
 }
 
+template <translation_table_regime regime>
+bool translation_table<regime>::translate(uint64_t va, uint64_t& pa) {
+    bool writable;
+    return translate(va, pa, writable);
+}
+
+template <translation_table_regime regime>
+bool translation_table<regime>::translate(uint64_t va, uint64_t& pa, bool& writable) {
+    auto level_items = items;
+    for(uint64_t level = 1; level <= MAXIMUM_LEVEL; level++) {
+        auto index = (va >> LEVEL_OFFSET[level]) & (0x1ff);
+        if((level_items[index] & 0x1) == 0) {
+            return false;
+        }
+        if(level == MAXIMUM_LEVEL) {
+            auto& page = reinterpret_cast<page_descriptor&>(level_items[index]);
+            pa = (page.addr << 12) + va % PAGE_SIZE;
+            writable = (page.ap & 0b10) == 0;   // 0b1x: read-only
+            return true;
+        }
+        auto& table = reinterpret_cast<table_descriptor&>(level_items[index]);
+        level_items = reinterpret_cast<uint64_t*>((table.next_level_table_addr << 12) + KA_BEGIN);
+    }
+    return false;
+}
+
+template <translation_table_regime regime>
+bool translation_table<regime>::unset_page(uint64_t va) {
+    auto level_items = items;
+    for(uint64_t level = 1; level <= MAXIMUM_LEVEL; level++) {
+        auto index = (va >> LEVEL_OFFSET[level]) & (0x1ff);
+        if((level_items[index] & 0x1) == 0) {
+            return false;
+        }
+        if(level == MAXIMUM_LEVEL) {
+            level_items[index] = 0;
+            return true;
+        }
+        auto& table = reinterpret_cast<table_descriptor&>(level_items[index]);
+        level_items = reinterpret_cast<uint64_t*>((table.next_level_table_addr << 12) + KA_BEGIN);
+    }
+    return false;
+}
+
 template <translation_table_regime regime>
 void translation_table<regime>::dump_recursively(uint64_t goffset, uint64_t level, uint64_t* level_items) {
     if(level_items == nullptr) {
@@ -179,7 +223,8 @@ void translation_table<regime>::activate() {
 
             DSB      SY
 
-            TLBI     VMALLE1
+            // the kernel table is shared by every cpu
+            TLBI     VMALLE1IS
             DSB      SY
             ISB
         )" : : "r" (pa): "x0");
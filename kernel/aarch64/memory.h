@@ -35,8 +35,16 @@ public:
     constexpr static uint64_t LEVEL_OFFSET[4] = {12 + 27, 12 + 18, 12 + 9, 12 + 0};
     constexpr static uint64_t MAXIMUM_LEVEL = sizeof(LEVEL_OFFSET) / sizeof(LEVEL_OFFSET[0]) - 1;
     constexpr static uint64_t PAGE_SIZE = 1 << LEVEL_OFFSET[MAXIMUM_LEVEL];
-    void set_page(uint64_t va, uint64_t pa, uint64_t level = 1, uint64_t* level_items = nullptr);
+    // readonly only matters for user tables: the page is then read-only at EL0 and EL1
+    void set_page(uint64_t va, uint64_t pa, bool readonly = false, uint64_t level = 1, uint64_t* level_items = nullptr);
     vector<pair<uint64_t, uint64_t>> get_all_pages();
+    // walks the table for a single address. false if va is not mapped
+    bool translate(uint64_t va, uint64_t& pa);
+    // the same, and whether the mapping permits stores
+    bool translate(uint64_t va, uint64_t& pa, bool& writable);
+    // the physical page is left to the caller. false if va was not mapped.
+    // takes effect on the next activate
+    bool unset_page(uint64_t va);
     void dump();
     void activate();
 
@@ -1,19 +1,64 @@
 #include "time.h"
-#include "wwos/format.h"
+#include "../global.h"
+#include "memory.h"
+
+#include "wwos/time.h"
 
 namespace wwos::kernel {
+    constexpr uint64_t TIME_SHIFT = 32;
+
+    static uint64_t us_mult = 0;
+    static uint64_t time_page_pa = 0;
+
+    static uint64_t read_frequency() {
+        uint64_t frequency;
+        asm volatile("MRS %0, CNTFRQ_EL0" : "=r"(frequency));
+        return frequency;
+    }
+
+    // a 64-bit multiply and a shift instead of two divisions
     wwos::uint64_t get_cpu_time() {
-        uint64_t physical_clock = 0;
-        uint64_t physical_freq = 0;
+        if(us_mult == 0) {
+            // before initialize_time, e.g. an early assert
+            us_mult = (1000000ull << TIME_SHIFT) / read_frequency();
+        }
 
+        uint64_t physical_clock;
         asm volatile("MRS %0, CNTPCT_EL0" : "=r"(physical_clock));
-        asm volatile("MRS %0, CNTFRQ_EL0" : "=r"(physical_freq));
-        
-        uint64_t physical_clock_div = physical_clock / physical_freq;
-        uint64_t physical_clock_mod = physical_clock % physical_freq;
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(physical_clock) * us_mult) >> TIME_SHIFT);
+    }
 
-        uint64_t physical_time = physical_clock_div * 1000000 + physical_clock_mod * 1000000 / physical_freq;
+    void initialize_time() {
+        auto frequency = read_frequency();
+        us_mult = (1000000ull << TIME_SHIFT) / frequency;
+
+        time_page_pa = pallocator->alloc();
+        ttkernel->set_page(time_page_pa, time_page_pa);
+        ttkernel->activate();
+
+        uint64_t counter;
+        asm volatile("ISB; MRS %0, CNTVCT_EL0" : "=r"(counter));
+
+        auto page = reinterpret_cast<time_page*>(KA_BEGIN + time_page_pa);
+        *page = time_page {
+            .frequency = frequency,
+            .mult = (1000000000ull << TIME_SHIFT) / frequency,
+            .shift = TIME_SHIFT,
+            .boot_counter = counter,
+        };
+    }
+
+    void enable_user_counter_access() {
+        // CNTKCTL_EL1.EL0VCTEN
+        asm volatile(R"(
+            MRS x0, CNTKCTL_EL1
+            ORR x0, x0, #0b10
+            MSR CNTKCTL_EL1, x0
+            ISB
+        )" : : : "x0");
+    }
 
-        return physical_time;
+    wwos::uint64_t get_time_page_pa() {
+        return time_page_pa;
     }
-}
\ No newline at end of file
+}
@@ -4,7 +4,15 @@
 #include "wwos/stdint.h"
 
 namespace wwos::kernel {
+    // microseconds of the physical counter
     wwos::uint64_t get_cpu_time();
+
+    // computes the conversion constants and fills the time page. needs the page allocator
+    void initialize_time();
+    // lets EL0 read CNTVCT_EL0. per cpu
+    void enable_user_counter_access();
+    // physical address of the time page, mapped read-only into every task
+    wwos::uint64_t get_time_page_pa();
 }
 
-#endif
\ No newline at end of file
+#endif
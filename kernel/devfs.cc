@@ -0,0 +1,69 @@
+#include "devfs.h"
+#include "vfs.h"
+
+#include "wwos/assert.h"
+
+namespace wwos::kernel {
+    // the root is 0, device i is i + 1
+    static vector<string>& get_devices(mount* mnt) {
+        return *static_cast<vector<string>*>(mnt->data);
+    }
+
+    static int64_t devfs_get_root(mount* mnt) {
+        return 0;
+    }
+
+    static int64_t devfs_lookup(mount* mnt, int64_t dir, string_view name) {
+        auto& devices = get_devices(mnt);
+        for(size_t i = 0; i < devices.size(); i++) {
+            if(string_view(devices[i]) == name) {
+                return i + 1;
+            }
+        }
+        return -1;
+    }
+
+    static int64_t devfs_create(mount* mnt, int64_t dir, string_view name, fd_type type) {
+        if(type != fd_type::FIFO || devfs_lookup(mnt, dir, name) >= 0) {
+            return -1;
+        }
+        auto& devices = get_devices(mnt);
+        devices.push_back(string(name.data(), name.size()));
+        return devices.size();
+    }
+
+    static fd_type devfs_get_type(mount* mnt, int64_t id) {
+        return id == 0 ? fd_type::DIRECTORY : fd_type::FIFO;
+    }
+
+    static size_t devfs_get_size(mount* mnt, int64_t id) {
+        return 0;
+    }
+
+    static vector<string> devfs_get_children(mount* mnt, int64_t dir) {
+        return get_devices(mnt);
+    }
+
+    static size_t devfs_read(mount* mnt, int64_t id, size_t offset, size_t size, void* buffer) {
+        return 0;
+    }
+
+    static void devfs_truncate(mount* mnt, int64_t id) {}
+
+    constexpr vfs_operations devfs_operations = {
+        .get_root = devfs_get_root,
+        .lookup = devfs_lookup,
+        .create = devfs_create,
+        .get_type = devfs_get_type,
+        .get_size = devfs_get_size,
+        .get_children = devfs_get_children,
+        .read = devfs_read,
+        .write = nullptr,
+        .truncate = devfs_truncate,
+        .cache_lookups = true,
+    };
+
+    void mount_devfs(string_view path) {
+        mount_file_system(path, &devfs_operations, new vector<string>());
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef _WWOS_KERNEL_DEVFS_H
+#define _WWOS_KERNEL_DEVFS_H
+
+#include "wwos/string_view.h"
+
+namespace wwos::kernel {
+    // a flat directory of device FIFOs such as /dev/console, created by the
+    // drivers behind them
+    void mount_devfs(string_view path);
+}
+
+#endif
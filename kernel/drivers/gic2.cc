@@ -21,6 +21,7 @@ static constexpr size_t GICD_ICPENDR = 0x0280;
 static constexpr size_t GICD_ITARGETSR = 0x0800;
 static constexpr size_t GICD_IPRIORITYR = 0x0400;
 static constexpr size_t GICD_ICFGR = 0x0c00;
+static constexpr size_t GICD_SGIR = 0x0f00;
 
 static constexpr size_t GICD_CTLR_ENABLE = 1;
 static constexpr size_t GICD_ISENABLER_SIZE = 32;
@@ -32,6 +33,7 @@ static constexpr size_t GICD_IPRIORITY_SIZE = 4;
 static constexpr size_t GICD_IPRIORITY_BITS = 8;
 static constexpr size_t GICD_ICFGR_SIZE = 16;
 static constexpr size_t GICD_ICFGR_BITS = 2;
+static constexpr size_t GICD_SGIR_TARGET_SHIFT = 16;
 
 static constexpr size_t GICC_CTLR = 0x0000;
 static constexpr size_t GICC_PMR = 0x0004;
@@ -49,6 +51,10 @@ gic02_driver::gic02_driver(size_t gicd_base, size_t gicc_base) : gicd_base(gicd_
 
 void gic02_driver::initialize() {
     write_volatile<uint32_t>(gicd_base + GICD_CTLR, GICD_CTLR_ENABLE);
+    initialize_cpu_interface();
+}
+
+void gic02_driver::initialize_cpu_interface() {
     write_volatile<uint32_t>(gicc_base + GICC_CTLR, GICC_CTLR_ENABLE);
     write_volatile<uint32_t>(gicc_base + GICC_PMR, GICC_PMR_PRIO_LOW);
     write_volatile<uint32_t>(gicc_base + GICC_BPR, GICC_BPR_NO_GROUP);
@@ -102,8 +108,13 @@ void gic02_driver::set_config(size_t interrupt, size_t config) {
     write_volatile<uint32_t>(addr, value);
 }
 
+// target list filter 0: only the cores in the target list
+void gic02_driver::send_sgi(size_t interrupt, size_t core) {
+    write_volatile<uint32_t>(gicd_base + GICD_SGIR, ((1 << core) << GICD_SGIR_TARGET_SHIFT) | interrupt);
+}
+
 // GICC_IAR & GICC_EOIR contains CPUID && interrupt ID
-// currently support only CPU 0
+// both are banked, they refer to the calling cpu
 
 uint32_t gic02_driver::get_interrupt_id() {
     return read_volatile<uint32_t>(gicc_base + GICC_IAR);
@@ -9,8 +9,12 @@ class gic02_driver {
 public:
     gic02_driver(size_t gicd_base, size_t gicc_base);
 
+    // enables the distributor and the calling cpu's interface
     void initialize();
 
+    // GICC registers are banked, each cpu enables its own interface
+    void initialize_cpu_interface();
+
     void enable(size_t interrupt);
 
     void disable(size_t interrupt);
@@ -23,8 +27,11 @@ public:
 
     void set_config(size_t interrupt, size_t config);
 
+    // raises software generated interrupt (0 - 15) on core
+    void send_sgi(size_t interrupt, size_t core);
+
     // GICC_IAR & GICC_EOIR contains CPUID && interrupt ID
-    // currently support only CPU 0
+    // both are banked, they refer to the calling cpu
 
     uint32_t get_interrupt_id();
 
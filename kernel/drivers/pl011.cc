@@ -3,27 +3,70 @@
 
 namespace wwos::kernel {
 
+    constexpr size_t UARTDR = 0x00;
     constexpr size_t UARTFR = 0x18;
-    constexpr size_t pl011_FR_RXFF = 1 << 6;
+    constexpr size_t UARTLCR_H = 0x2c;
+    constexpr size_t UARTIMSC = 0x38;
+    constexpr size_t UARTICR = 0x44;
+
+    constexpr size_t pl011_FR_RXFE = 1 << 4;
+    constexpr size_t pl011_FR_TXFF = 1 << 5;
+    constexpr size_t pl011_LCR_H_FEN = 1 << 4;
+    constexpr size_t pl011_DR_DATA = 0xff;
+    constexpr size_t pl011_INT_RX = 1 << 4;
+    constexpr size_t pl011_INT_TX = 1 << 5;
+    constexpr size_t pl011_INT_RT = 1 << 6;     // receive timeout, fires for a partially filled fifo
 
     pl011_driver::pl011_driver(size_t base) : base(base) {}
 
-    void pl011_driver::initialize() {}
+    void pl011_driver::initialize() {
+        // with the fifos on, one transmit interrupt moves a burst instead of a single byte
+        auto lcr_h = reinterpret_cast<volatile uint32_t*>(base + UARTLCR_H);
+        *lcr_h = *lcr_h | pl011_LCR_H_FEN;
+    }
 
     bool pl011_driver::readable() {
-        return *reinterpret_cast<volatile uint32_t*>(base + UARTFR) & pl011_FR_RXFF;
+        return !(*reinterpret_cast<volatile uint32_t*>(base + UARTFR) & pl011_FR_RXFE);
+    }
+
+    bool pl011_driver::writable() {
+        return !(*reinterpret_cast<volatile uint32_t*>(base + UARTFR) & pl011_FR_TXFF);
     }
 
     int32_t pl011_driver::read() {
         if(readable()) {
-            return *reinterpret_cast<volatile uint32_t*>(base);
+            return *reinterpret_cast<volatile uint32_t*>(base + UARTDR) & pl011_DR_DATA;
         } else {
             return -1;
         }
     }
 
     void pl011_driver::write(int32_t value) {
-        *reinterpret_cast<volatile uint32_t*>(base) = value;
+        while(!writable());
+        *reinterpret_cast<volatile uint32_t*>(base + UARTDR) = value;
+    }
+
+    void pl011_driver::enable_rx_interrupt() {
+        auto imsc = reinterpret_cast<volatile uint32_t*>(base + UARTIMSC);
+        *imsc = *imsc | pl011_INT_RX | pl011_INT_RT;
+    }
+
+    void pl011_driver::clear_rx_interrupt() {
+        *reinterpret_cast<volatile uint32_t*>(base + UARTICR) = pl011_INT_RX | pl011_INT_RT;
+    }
+
+    void pl011_driver::enable_tx_interrupt() {
+        auto imsc = reinterpret_cast<volatile uint32_t*>(base + UARTIMSC);
+        *imsc = *imsc | pl011_INT_TX;
+    }
+
+    void pl011_driver::disable_tx_interrupt() {
+        auto imsc = reinterpret_cast<volatile uint32_t*>(base + UARTIMSC);
+        *imsc = *imsc & ~pl011_INT_TX;
+    }
+
+    void pl011_driver::clear_tx_interrupt() {
+        *reinterpret_cast<volatile uint32_t*>(base + UARTICR) = pl011_INT_TX;
     }
 
 }
\ No newline at end of file
@@ -9,9 +9,20 @@ namespace wwos::kernel {
         void initialize();
 
         bool readable();
+        bool writable();
         int32_t read();
+        // waits for room in the transmit fifo
         void write(int32_t value);
 
+        // raises the interrupt line while received data is waiting
+        void enable_rx_interrupt();
+        void clear_rx_interrupt();
+
+        // raises the interrupt line once the transmit fifo has drained
+        void enable_tx_interrupt();
+        void disable_tx_interrupt();
+        void clear_tx_interrupt();
+
     protected:
         size_t base;
     };
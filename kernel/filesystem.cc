@@ -1,117 +1,233 @@
+#include "devfs.h"
 #include "filesystem.h"
+#include "global.h"
+#include "memory.h"
 #include "process.h"
+#include "tmpfs.h"
+#include "vfs.h"
+#include "wwfs_driver.h"
 #include "wwos/algorithm.h"
 #include "wwos/alloc.h"
 #include "wwos/assert.h"
-#include "wwos/avl.h"
 #include "wwos/format.h"
-#include "wwos/list.h"
-#include "wwos/map.h"
+#include "wwos/hash_map.h"
 #include "wwos/queue.h"
 #include "wwos/stdint.h"
 #include "wwos/stdio.h"
 #include "wwos/string_view.h"
 #include "wwos/syscall.h"
 #include "wwos/vector.h"
-#include "wwos/wwfs.h"
 
 namespace wwos::kernel {
-    constexpr size_t FIFO_SIZE = 1 << 20; // 1 MB buffer
+    void* fifo_page_allocator::allocate() {
+        auto pa = pallocator->alloc();
+        if(pa == 0) {
+            return nullptr;
+        }
+        ttkernel->set_page(pa, pa);
+        ttkernel->activate();
+        return reinterpret_cast<void*>(KA_BEGIN + pa);
+    }
+
+    void fifo_page_allocator::free(void* segment) {
+        pallocator->free(reinterpret_cast<uint64_t>(segment) - KA_BEGIN);
+    }
 
-    struct fifo_file {
-        fifo_file(): fifo(cycle_queue<uint8_t>(FIFO_SIZE)) {}
-        cycle_queue<uint8_t> fifo;
+    vector<mount*>* p_mounts;
+
+    // a (directory, name) lookup of some mount
+    struct dentry_key {
+        mount* mnt;
+        int64_t parent;
+        string name;
+    };
+
+    // the same without owning the name, to probe the cache without allocating
+    struct dentry_ref {
+        mount* mnt;
+        int64_t parent;
+        string_view name;
     };
 
+    static bool operator==(const dentry_key& a, const dentry_key& b) {
+        return a.mnt == b.mnt && a.parent == b.parent && a.name == b.name;
+    }
 
-    wwos::wwfs::file_system_hardware_memory* fs_hw_memory = nullptr;
-    wwos::wwfs::basic_file_system* fs = nullptr;
+    static bool operator==(const dentry_key& a, const dentry_ref& b) {
+        return a.mnt == b.mnt && a.parent == b.parent && string_view(a.name) == b.name;
+    }
+
+    struct dentry_hash {
+        uint64_t operator()(const dentry_key& key) const {
+            return (*this)(dentry_ref { key.mnt, key.parent, key.name });
+        }
+
+        uint64_t operator()(const dentry_ref& key) const {
+            return hash_bytes(key.name.data(), key.name.size()) ^ hash_integer(reinterpret_cast<uint64_t>(key.mnt) + key.parent);
+        }
+    };
+
+    // id -1: a negative entry, the name does not exist
+    struct dentry {
+        int64_t id;
+        fd_type type;
+    };
 
-    wwos::map<shared_file_node*, uint64_t>* p_snode_inode;
-    wwos::map<uint64_t, shared_file_node*>* p_inode_snode;
+    // dropped as a whole once it reaches this size
+    constexpr size_t DENTRY_CACHE_SIZE = 4096;
 
-    wwos::map<shared_file_node*, fifo_file>* p_fifo;
+    hash_map<dentry_key, dentry, dentry_hash>* p_dentries;
 
 
 
     void initialize_filesystem(void* addr, size_t size) {
-        wwassert(size >= sizeof(wwos::wwfs::meta_t), "Invalid size");
-
-        wwos::wwfs::meta_t meta;
-        memcpy(&meta, addr, sizeof(wwos::wwfs::meta_t));
-        fs_hw_memory = new wwos::wwfs::file_system_hardware_memory(addr, meta.block_size, meta.required_size() / meta.block_size);
-        
-        fs = new wwos::wwfs::basic_file_system(fs_hw_memory);
-        fs->initialize();
-
-        p_snode_inode = new map<shared_file_node*, uint64_t>();
-        p_inode_snode = new map<uint64_t, shared_file_node*>();
-        p_fifo = new map<shared_file_node*, fifo_file>();
+        p_mounts = new vector<mount*>();
+        p_dentries = new hash_map<dentry_key, dentry, dentry_hash>();
+
+        mount_wwfs("/", addr, size);
+        mount_devfs("/dev");
+        mount_tmpfs("/tmp");
     }
 
-    int64_t get_inode(string_view path) {
-        if(path == "/") {
-            return fs->get_root();
+    mount* mount_file_system(string_view path, const vfs_operations* ops, void* data) {
+        wwassert(path.size() > 0 && path[0] == '/', "mount point must be absolute");
+        if(path.size() > 1 && path[path.size() - 1] == '/') {
+            path = path.substr(0, path.size() - 1);
         }
-        if(path.size() == 0) {
-            return -1;
+        for(auto mnt: *p_mounts) {
+            wwassert(string_view(mnt->path) != path, "already mounted");
         }
 
-        if(path[0] != '/') {
-            return -1;
+        auto mnt = new mount { .path = string(path.data(), path.size()), .ops = ops, .data = data };
+        p_mounts->push_back(mnt);
+        wwfmtlog("mounted {}", path);
+        return mnt;
+    }
+
+    // the mount path lies in, the one with the longest matching prefix. rest is
+    // the remainder of path inside it
+    static mount* find_mount(string_view path, string_view& rest) {
+        mount* found = nullptr;
+        size_t found_size = 0;
+        for(auto mnt: *p_mounts) {
+            auto mount_path = string_view(mnt->path);
+            if(mount_path == "/") {
+                if(found == nullptr) {
+                    found = mnt;
+                    found_size = 1;
+                }
+                continue;
+            }
+            if(path.size() < mount_path.size() || path.substr(0, mount_path.size()) != mount_path) {
+                continue;
+            }
+            if(path.size() > mount_path.size() && path[mount_path.size()] != '/') {
+                continue;
+            }
+            if(mount_path.size() > found_size) {
+                found = mnt;
+                found_size = mount_path.size();
+            }
         }
+        rest = path.substr(found_size, path.size() - found_size);
+        return found;
+    }
 
-        if(path[path.size() - 1] == '/' && path.size() > 1) {
-            path = path.substr(0, path.size() - 1);
+    // name in dir, through the dentry cache: a hit is one hash probe
+    static dentry lookup(mount* mnt, int64_t dir, string_view name) {
+        if(!mnt->ops->cache_lookups) {
+            auto id = mnt->ops->lookup(mnt, dir, name);
+            return { id, id >= 0 ? mnt->ops->get_type(mnt, id) : fd_type::FILE };
         }
 
-        auto parent = fs->get_root();
-        auto children = fs->get_children(parent);
+        auto cached = p_dentries->find_as(dentry_ref { mnt, dir, name });
+        if(cached != nullptr) {
+            return *cached;
+        }
 
-        size_t path_index = 1;
-        while(path_index < path.size()) {
-            size_t next_index = path.find('/', path_index);
-            if(next_index == string_view::npos) {
-                next_index = path.size();
-            }
-            auto name_piece = path.substr(path_index, next_index - path_index);
-
-            bool found = false;
-            for(auto& [child_name, child_id] : children) {
-                if(string_view(child_name) == name_piece) {
-                    parent = child_id;
-                    found = true;
-                    break;
-                }
-            }
+        auto id = mnt->ops->lookup(mnt, dir, name);
+        dentry entry = { id, id >= 0 ? mnt->ops->get_type(mnt, id) : fd_type::FILE };
+        if(p_dentries->size() >= DENTRY_CACHE_SIZE) {
+            p_dentries->clear();
+        }
+        p_dentries->insert({ mnt, dir, string(name.data(), name.size()) }, entry);
+        return entry;
+    }
 
-            if(!found) {
-                return -1;
-            }
+    // the mount, id and type of an absolute path, false if it does not exist
+    static bool resolve(string_view path, mount*& mnt, int64_t& id, fd_type& type) {
+        if(path.size() == 0 || path[0] != '/') {
+            return false;
+        }
 
-            if(next_index == path.size()) {
-                return parent;
-            }
+        string_view rest;
+        mnt = find_mount(path, rest);
+        if(mnt == nullptr) {
+            return false;
+        }
 
-            auto nodetype = fs->get_inode_type(parent);
-            if(nodetype != wwos::wwfs::inode_type::DIRECTORY) {
-                return -1;
+        id = mnt->ops->get_root(mnt);
+        type = fd_type::DIRECTORY;
+        size_t i = 0;
+        while(i < rest.size()) {
+            auto next = rest.find('/', i);
+            if(next == string_view::npos) {
+                next = rest.size();
             }
+            if(next > i) {
+                if(type != fd_type::DIRECTORY) {
+                    return false;
+                }
+                auto entry = lookup(mnt, id, rest.substr(i, next - i));
+                if(entry.id < 0) {
+                    return false;
+                }
+                id = entry.id;
+                type = entry.type;
+            }
+            i = next + 1;
+        }
+        return true;
+    }
 
-            children = fs->get_children(parent);
-            path_index = next_index + 1;
+    // the cached vnode of id, created on first use
+    static shared_file_node* get_vnode(mount* mnt, int64_t id, fd_type type) {
+        auto cached = mnt->vnodes.find(id);
+        if(cached != nullptr) {
+            return *cached;
         }
 
-        return -1;
+        auto sfn = new shared_file_node();
+        sfn->mnt = mnt;
+        sfn->inode = id;
+        sfn->type = type;
+        mnt->vnodes.insert(id, sfn);
+        return sfn;
+    }
+
+    void vfs_unlink(mount* mnt, int64_t id) {
+        auto cached = mnt->vnodes.find(id);
+        if(cached == nullptr) {
+            return;
+        }
+        auto sfn = *cached;
+        mnt->vnodes.remove(id);
+        sfn->unlinked = true;
+        if(mnt->ops->cache_lookups) {
+            // rare enough not to index the cache by id as well
+            p_dentries->clear();
+        }
+        if(sfn->readers.size() == 0 && sfn->writers.size() == 0) {
+            delete sfn;
+        }
     }
 
     size_t read_shared_node(void* buffer, shared_file_node* node, size_t offset, size_t size) {
         wwassert(node, "Invalid inode id");
         if(node->type == fd_type::FIFO) {
-            auto& fifo = p_fifo->get(node);
-            auto read_size = min(fifo.fifo.size(), size);
-            for(size_t i = 0; i < read_size; i++) {
-                wwassert(fifo.fifo.pop(((uint8_t*)buffer)[i]), "FIFO pop failed");
+            auto read_size = node->fifo.pop(static_cast<uint8_t*>(buffer), size);
+            if(read_size > 0) {
+                wake_up(node->write_waiters);
             }
             return read_size;
         }
@@ -120,50 +236,104 @@ namespace wwos::kernel {
             return 0;
         }
 
-        return fs->read_data(node->inode, offset, size, buffer);
+        return node->mnt->ops->read(node->mnt, node->inode, offset, size, buffer);
     }
 
     size_t write_shared_node(void* buffer, shared_file_node* node, size_t offset, size_t size) {
         wwassert(node, "Invalid inode id");
         if(node->type == fd_type::FIFO) {
-            auto& fifo = p_fifo->get(node);
-            auto write_size = min(FIFO_SIZE - fifo.fifo.size(), size);
-            for(size_t i = 0; i < write_size; i++) {
-                wwassert(fifo.fifo.push(((uint8_t*)buffer)[i]), "FIFO push failed");
+            auto write_size = node->fifo.push(static_cast<uint8_t*>(buffer), size);
+            if(write_size > 0) {
+                wake_up(node->read_waiters);
             }
             return write_size;
-        } 
+        }
 
-        return fs->write_data(node->inode, offset, size, buffer);
+        wwassert(node->mnt->ops->write != nullptr, "read only file system");
+        return node->mnt->ops->write(node->mnt, node->inode, offset, size, buffer);
     }
 
     size_t get_shared_node_size(shared_file_node* node) {
         wwassert(node, "Invalid inode id");
         if(node->type == fd_type::FIFO) {
-            return p_fifo->get(node).fifo.size();
+            return node->fifo.size();
         }
-        return fs->get_inode_size(node->inode);
+        return node->mnt->ops->get_size(node->mnt, node->inode);
+    }
+
+    size_t get_fifo_space(shared_file_node* node) {
+        wwassert(node && node->type == fd_type::FIFO, "not a fifo");
+        return node->fifo.space();
     }
 
-    vector<pair<string, int64_t>> get_children(int64_t parent) {
-        wwassert(parent >= 0, "Invalid parent id");
-        return fs->get_children(parent);
+    void set_fifo_capacity(shared_file_node* node, size_t capacity) {
+        wwassert(node && node->type == fd_type::FIFO, "not a fifo");
+        node->fifo.set_capacity(capacity);
+        wake_up(node->write_waiters);
     }
-    
+
+    bool fifo_at_eof(shared_file_node* node) {
+        wwassert(node && node->type == fd_type::FIFO, "not a fifo");
+        return node->had_writer && node->writers.size() == 0 && node->fifo.size() == 0;
+    }
+
+    pair<string_view, string_view> get_parent_path(string_view path) {
+        if(path == "/" || path.size() == 0) {
+            return {"", ""};
+        }
+
+        if(path[path.size() - 1] == '/') {
+            path = path.substr(0, path.size() - 1);
+        }
+
+        size_t last_slash = path.find_last_of('/');
+        if(last_slash == string_view::npos) {
+            return {"", ""};
+        }
+
+        auto parent_path = path.substr(0, last_slash);
+        if(parent_path.size() == 0) {
+            parent_path = "/";
+        }
+
+        return {parent_path, path.substr(last_slash + 1, path.size() - last_slash - 1)};
+    }
+
     uint64_t get_flattened_children(shared_file_node* node, uint8_t* buffer, uint64_t size) {
         wwassert(node, "Invalid inode id");
-        auto parent = node->inode;
+        auto children = node->mnt->ops->get_children(node->mnt, node->inode);
+
+        // mount points show up in their parent directory, existing there or not
+        for(auto mnt: *p_mounts) {
+            auto [parent_path, name] = get_parent_path(mnt->path);
+            mount* parent_mnt;
+            int64_t parent_id;
+            fd_type parent_type;
+            if(parent_path.size() == 0 || !resolve(parent_path, parent_mnt, parent_id, parent_type)) {
+                continue;
+            }
+            if(parent_mnt != node->mnt || parent_id != node->inode) {
+                continue;
+            }
+            bool listed = false;
+            for(auto& child: children) {
+                listed = listed || string_view(child) == name;
+            }
+            if(!listed) {
+                children.push_back(string(name.data(), name.size()));
+            }
+        }
+
         // return extra bytes required. 0 means succ
-        auto children = fs->get_children(parent);
         uint64_t required_size = 0;
-        for(auto& [name, id]: children) {
+        for(auto& name: children) {
             required_size += name.size() + 1;
         }
         if(size < required_size) {
             return required_size;
         }
         size_t i = 0;
-        for(auto& [name, id]: children) {
+        for(auto& name: children) {
             memcpy(buffer + i, name.data(), name.size());
             i += name.size();
             buffer[i++] = '\0';
@@ -174,62 +344,33 @@ namespace wwos::kernel {
         return 0;
     }
 
-    void init_fifo(shared_file_node* sfn) {
-        wwlog("initing fifo");
-        fifo_file ff;
-        p_fifo->insert(sfn, ff);
-    }
-    
     shared_file_node* open_shared_file_node(uint64_t pid, string_view path, fd_mode mode) {
         wwfmtlog("trying to open {} with mode {}. by {}", path, static_cast<int>(mode), pid);
 
-        auto inode = get_inode(path);
-        if(inode < 0) {
+        mount* mnt;
+        int64_t id;
+        fd_type type;
+        if(!resolve(path, mnt, id, type)) {
             return nullptr;
         }
 
-        auto node_type = fs->get_inode_type(inode);
-        if(node_type == wwfs::inode_type::DIRECTORY && mode == fd_mode::WRITEONLY) {
-            return nullptr;
+        if(mode == fd_mode::WRITEONLY) {
+            if(type == fd_type::DIRECTORY || (type == fd_type::FILE && mnt->ops->write == nullptr)) {
+                return nullptr;
+            }
         }
 
-        if(!p_inode_snode->contains(inode)) {
-            // create one!
-            auto sfn = new shared_file_node();
-            sfn->inode = inode;
-            
-            if(node_type == wwfs::inode_type::DIRECTORY) {
-                sfn->type = fd_type::DIRECTORY;
-            } else if(node_type == wwfs::inode_type::FILE) {
-                sfn->type = fd_type::FILE;
-            } else {
-                sfn->type = fd_type::FIFO;
-                init_fifo(sfn);
-            } 
-
-            if(mode == fd_mode::READONLY) {
-                sfn->readers.push_back(pid);
-            } else {
-                sfn->writers.push_back(pid);
-                if(sfn->type == fd_type::FILE) {
-                    fs->resize_inode(sfn->inode, 0);
-                }
-            }
-            p_inode_snode->insert(inode, sfn);
-            p_snode_inode->insert(sfn, inode);
-            return sfn;
+        auto sfn = get_vnode(mnt, id, type);
+        if(mode == fd_mode::READONLY) {
+            sfn->readers.push_back(pid);
         } else {
-            auto sfn = p_inode_snode->get(inode);
-            if(mode == fd_mode::READONLY) {
-                sfn->readers.push_back(pid);
-            } else {
-                sfn->writers.push_back(pid);
-                if(sfn->type == fd_type::FILE) {
-                    fs->resize_inode(sfn->inode, 0);
-                }
+            sfn->writers.push_back(pid);
+            sfn->had_writer = true;
+            if(sfn->type == fd_type::FILE) {
+                mnt->ops->truncate(mnt, id);
             }
-            return sfn;
         }
+        return sfn;
     }
 
     bool close_shared_file_node(uint64_t pid, shared_file_node* sfn) {
@@ -241,7 +382,7 @@ namespace wwos::kernel {
         if(it != sfn->readers.end()) {
             sfn->readers.erase(it);
             action = true;
-        } 
+        }
 
         it = sfn->writers.find(pid);
         if(it != sfn->writers.end()) {
@@ -249,50 +390,37 @@ namespace wwos::kernel {
             action = true;
         }
 
+        if(sfn->type == fd_type::FIFO) {
+            // blocked peers have to notice end of file / a vanished reader
+            if(sfn->writers.size() == 0) {
+                wake_up(sfn->read_waiters);
+            }
+            if(sfn->readers.size() == 0) {
+                wake_up(sfn->write_waiters);
+            }
+        }
+
         if(sfn->writers.size() == 0 && sfn->readers.size() == 0) {
-            
+            if(sfn->unlinked) {
+                delete sfn;
+                return action;
+            }
+
+            // unread data is kept for the next opener
             if(sfn->type == fd_type::FIFO) {
-                auto fifo = p_fifo->get(sfn);
-                if(fifo.fifo.size() > 0) {
-                    wwfmtlog("fifo has {} bytes left", fifo.fifo.size());
+                if(sfn->fifo.size() > 0) {
+                    wwfmtlog("fifo has {} bytes left", sfn->fifo.size());
                     return false;
                 }
             }
 
-            p_inode_snode->remove(p_snode_inode->get(sfn));
-            p_snode_inode->remove(sfn);
-            if(sfn->type == fd_type::FIFO) {
-                auto fifo = p_fifo->get(sfn);
-                p_fifo->remove(sfn);
-            }
+            sfn->mnt->vnodes.remove(sfn->inode);
             delete sfn;
         }
 
         return action;
     }
 
-    pair<string_view, string_view> get_parent_path(string_view path) {
-        if(path == "/" || path.size() == 0) {
-            return {"", ""};
-        }
-
-        if(path[path.size() - 1] == '/') {
-            path = path.substr(0, path.size() - 1);
-        }
-
-        size_t last_slash = path.find_last_of('/');
-        if(last_slash == string_view::npos) {
-            return {"", ""};
-        }
-
-        auto parent_path = path.substr(0, last_slash);
-        if(parent_path.size() == 0) {
-            parent_path = "/";
-        }
-
-        return {parent_path, path.substr(last_slash + 1, path.size() - last_slash - 1)};
-    }
-
     bool create_shared_file_node(string_view path, fd_type type) {
         if(path.size() == 0 || path[0] != '/') return false;
 
@@ -302,35 +430,33 @@ namespace wwos::kernel {
             return false;
         }
 
-        auto parent_inode = get_inode(parent_path);
-        if(parent_inode < 0) {
-            wwfmtlog("failed to get parent inode of {}", parent_path);
+        mount* mnt;
+        int64_t parent;
+        fd_type parent_type;
+        if(!resolve(parent_path, mnt, parent, parent_type)) {
+            wwfmtlog("failed to resolve parent {}", parent_path);
             return false;
         }
 
-        auto parent_type = fs->get_inode_type(parent_inode);
-        if(parent_type != wwfs::inode_type::DIRECTORY) {
+        if(parent_type != fd_type::DIRECTORY) {
             wwlog("parent is not a directory");
             return false;
         }
 
-        wwos::wwfs::inode_type itype;
-        if(type == fd_type::DIRECTORY) {
-            itype = wwfs::inode_type::DIRECTORY;
-        } else if(type == fd_type::FILE) {
-            itype = wwfs::inode_type::FILE;
-        } else {
-            itype = wwfs::inode_type::FIFO;
-        }
-
-        auto inode = fs->create(parent_inode, name, itype);
-        if(inode < 0) {
+        auto id = mnt->ops->create(mnt, parent, name, type);
+        if(id < 0) {
             wwlog("failed to create inode");
             return false;
         }
 
+        // a negative entry for the name is now wrong
+        auto cached = p_dentries->find_as(dentry_ref { mnt, parent, name });
+        if(cached != nullptr) {
+            *cached = { id, type };
+        }
+
         return true;
     }
 
 
-}
\ No newline at end of file
+}
@@ -2,17 +2,42 @@
 #define _WWOS_KERNEL_FILESYSTEM_H
 
 #include "wwos/pair.h"
+#include "wwos/queue.h"
 #include "wwos/stdint.h"
 #include "wwos/string_view.h"
 #include "wwos/syscall.h"
+
+#include "aarch64/memory.h"
+#include "vfs.h"
+#include "wait_queue.h"
+
 namespace wwos::kernel {
 
+// each segment is a physical page, reached through the kernel's linear map
+struct fifo_page_allocator {
+    static void* allocate();
+    static void free(void* segment);
+};
+
+// pages are only held while data is buffered, so an idle FIFO costs a few
+// dozen bytes however large its capacity
+using fifo_buffer = segmented_queue<uint8_t, translation_table_kernel::PAGE_SIZE, fifo_page_allocator>;
 
+// a vnode: one per open node of a mounted file system, shared by its openers
 struct shared_file_node {
-    int64_t inode;
+    mount* mnt;
+    int64_t inode;      // the driver's id within mnt
     fd_type type;
+    bool unlinked = false;      // no longer in mnt's cache, freed with the last close
     vector<int64_t> readers;
     vector<int64_t> writers;
+
+    // FIFO only. end of file is reported once the last writer is gone,
+    // but not before anyone opened the FIFO for writing.
+    bool had_writer = false;
+    fifo_buffer fifo{FIFO_DEFAULT_CAPACITY};
+    wait_queue read_waiters;    // until data arrives or the last writer closes
+    wait_queue write_waiters;   // until there is room in the buffer or the last reader closes
 };
 
 // logical
@@ -22,6 +47,7 @@ bool close_shared_file_node(uint64_t pid, shared_file_node* sfn);
 
 bool create_shared_file_node(string_view path, fd_type type);
 
+// mounts the wwfs image at addr on /, devfs on /dev and tmpfs on /tmp
 void initialize_filesystem(void* addr, size_t size);
 
 size_t read_shared_node(void* buffer, shared_file_node* node, size_t offset, size_t size);
@@ -30,6 +56,11 @@ size_t write_shared_node(void* buffer, shared_file_node* node, size_t offset, si
 
 size_t get_shared_node_size(shared_file_node* node);
 
+// FIFO only
+size_t get_fifo_space(shared_file_node* node);
+void set_fifo_capacity(shared_file_node* node, size_t capacity);
+bool fifo_at_eof(shared_file_node* node);
+
 uint64_t get_flattened_children(shared_file_node* node, uint8_t* buffer, uint64_t size);
 
 }
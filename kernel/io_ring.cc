@@ -0,0 +1,135 @@
+#include "io_ring.h"
+#include "global.h"
+#include "process.h"
+
+#include "wwos/algorithm.h"
+#include "wwos/defs.h"
+#include "wwos/format.h"
+#include "wwos/io_ring.h"
+#include "wwos/stdio.h"
+#include "wwos/string.h"
+
+namespace wwos::kernel {
+    static io_ring* get_ring(task_info& task) {
+        return reinterpret_cast<io_ring*>(KA_BEGIN + task.io_ring_pa);
+    }
+
+    static int64_t execute(task_info& task, const io_submission& sqe) {
+        switch(sqe.op) {
+            case io_op::NOP:
+                return 0;
+            case io_op::READ:
+                return task_read(&task, sqe.fd, reinterpret_cast<uint8_t*>(sqe.addr), sqe.size);
+            case io_op::WRITE:
+                return task_write(&task, sqe.fd, reinterpret_cast<uint8_t*>(sqe.addr), sqe.size);
+            case io_op::OPEN:
+                return task_open(&task, string_view(reinterpret_cast<const char*>(sqe.addr), sqe.size), static_cast<fd_mode>(sqe.flags));
+            case io_op::CLOSE:
+                return task_close(&task, sqe.fd);
+            case io_op::POLL: {
+                auto ready = task_poll(&task, reinterpret_cast<poll_fd*>(sqe.addr), sqe.size);
+                return ready == 0 ? FD_WOULD_BLOCK : ready;
+            }
+        }
+        return -1;
+    }
+
+    // completions the task has not consumed yet. a bogus cq_head counts as full
+    static uint32_t completions_waiting(io_ring* ring) {
+        auto waiting = ring->cq_tail - __atomic_load_n(&ring->cq_head, __ATOMIC_ACQUIRE);
+        return min<uint32_t>(waiting, IO_RING_ENTRIES);
+    }
+
+    static void complete(io_ring* ring, uint64_t user_data, int64_t result) {
+        auto tail = ring->cq_tail;
+        ring->cq[tail % IO_RING_ENTRIES] = io_completion { .user_data = user_data, .result = result };
+        __atomic_store_n(&ring->cq_tail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    void drain_io_ring(task_info& task) {
+        if(task.io_ring_pa == 0) {
+            return;
+        }
+        auto ring = get_ring(task);
+
+        // every op in flight has a completion slot reserved, so retries always fit
+        vector<io_submission> still_pending;
+        for(auto& sqe: task.io_pending) {
+            auto result = execute(task, sqe);
+            if(result == FD_WOULD_BLOCK) {
+                still_pending.push_back(sqe);
+            } else {
+                complete(ring, sqe.user_data, result);
+            }
+        }
+        task.io_pending = move(still_pending);
+
+        auto head = ring->sq_head;
+        auto tail = __atomic_load_n(&ring->sq_tail, __ATOMIC_ACQUIRE);
+        while(head != tail && completions_waiting(ring) + task.io_pending.size() < IO_RING_ENTRIES) {
+            auto sqe = ring->sq[head % IO_RING_ENTRIES];
+            head++;
+            __atomic_store_n(&ring->sq_head, head, __ATOMIC_RELEASE);
+
+            auto result = execute(task, sqe);
+            if(result == FD_WOULD_BLOCK) {
+                task.io_pending.push_back(sqe);
+            } else {
+                complete(ring, sqe.user_data, result);
+            }
+        }
+    }
+
+    void current_task_setup_io_ring() {
+        auto& task = get_current_task();
+        if(task.io_ring_pa != 0) {
+            task.pcb.set_return_value(USERSPACE_IO_RING);
+            return;
+        }
+
+        // a forked child has a plain copy of its parent's ring page, which is reused
+        uint64_t pa = 0;
+        for(auto& [va, p]: task.pcb.tt.get_all_pages()) {
+            if(va == USERSPACE_IO_RING) {
+                pa = p;
+            }
+        }
+        if(pa == 0) {
+            pa = pallocator->alloc();
+            ttkernel->set_page(pa, pa);
+            ttkernel->activate();
+            task.pcb.tt.set_page(USERSPACE_IO_RING, pa);
+            task.pcb.tt.activate();
+        }
+
+        memset(reinterpret_cast<void*>(KA_BEGIN + pa), 0, sizeof(io_ring));
+        task.io_ring_pa = pa;
+        task.pcb.set_return_value(USERSPACE_IO_RING);
+    }
+
+    void current_task_enter_io_ring(size_t min_complete) {
+        auto& task = get_current_task();
+        if(task.io_ring_pa == 0) {
+            task.pcb.set_return_value(-1);
+            return;
+        }
+
+        drain_io_ring(task);
+        auto ring = get_ring(task);
+        auto waiting = completions_waiting(ring);
+        if(waiting >= min_complete || task.io_pending.size() == 0) {
+            task.pcb.set_return_value(waiting);
+            return;
+        }
+
+        // restarted on the first wakeup, the drain above then retries
+        for(auto& sqe: task.io_pending) {
+            if(sqe.op == io_op::POLL) {
+                enqueue_poll_waiters(&task, reinterpret_cast<poll_fd*>(sqe.addr), sqe.size);
+            } else if(auto queue = get_fd_wait_queue(&task, sqe.fd)) {
+                enqueue_waiter(*queue);
+            }
+        }
+        block_current_task();
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef _WWOS_KERNEL_IO_RING_H
+#define _WWOS_KERNEL_IO_RING_H
+
+#include "wwos/stdint.h"
+
+namespace wwos::kernel {
+    struct task_info;
+
+    // retries the ops in flight, then runs new submissions while the completion
+    // queue has room for them. task must be the one whose tables are active, the
+    // buffers are its user addresses. does nothing if it has no ring
+    void drain_io_ring(task_info& task);
+
+    void current_task_setup_io_ring();
+    void current_task_enter_io_ring(size_t min_complete);
+}
+
+#endif
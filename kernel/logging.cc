@@ -1,14 +1,54 @@
+#include "wwos/assert.h"
+#include "wwos/queue.h"
 #include "wwos/stdint.h"
 
 #include "drivers/pl011.h"
 
 #include "logging.h"
+#include "filesystem.h"
 #include "global.h"
 
 
 namespace wwos::kernel {;
+    constexpr size_t TX_RING_SIZE = 1 << 16;
+
+    // output waiting for room in the uart transmit fifo, drained by the tx interrupt
+    cycle_queue<uint8_t>* tx_ring = nullptr;
+
+    static void flush_tx_ring() {
+        uint8_t c;
+        while(tx_ring != nullptr && tx_ring->pop(c)) {
+            g_uart->write(c);
+        }
+    }
+
+    static void push_tx_ring(uint8_t c) {
+        if(tx_ring->full()) {
+            uint8_t oldest;
+            tx_ring->pop(oldest);
+            g_uart->write(oldest);
+        }
+        tx_ring->push(c);
+    }
+
+    static void start_tx() {
+        uint8_t c;
+        while(g_uart->writable() && tx_ring->pop(c)) {
+            g_uart->write(c);
+        }
+
+        g_uart->clear_tx_interrupt();
+        if(tx_ring->size() > 0) {
+            g_uart->enable_tx_interrupt();
+        } else {
+            g_uart->disable_tx_interrupt();
+        }
+    }
+
+    // synchronous, so that it works from anywhere, including a failing assertion
     void kputchar(char c) {
         if(g_uart) {
+            flush_tx_ring();
             if(c == '\n') {
                 g_uart->write('\r');
             }
@@ -21,20 +61,54 @@ namespace wwos::kernel {;
         }
     }
 
+    shared_file_node* console_sfn = nullptr;
+
     int32_t kgetchar() {
-        if(g_uart) {
-            return g_uart->read();
+        uint8_t c;
+        if(console_sfn == nullptr || read_shared_node(&c, console_sfn, 0, 1) == 0) {
+            return -1;
+        }
+        return c;
+    }
+
+    void initialize_console() {
+        create_shared_file_node("/dev/console", fd_type::FIFO);
+
+        // the kernel stays the only writer, so the console never reaches end of file
+        console_sfn = open_shared_file_node(0, "/dev/console", fd_mode::WRITEONLY);
+        wwassert(console_sfn, "failed to open console");
+
+        tx_ring = new cycle_queue<uint8_t>(TX_RING_SIZE);
+        g_uart->enable_rx_interrupt();
+    }
+
+    void on_console_interrupt() {
+        int32_t c;
+        while((c = g_uart->read()) >= 0) {
+            uint8_t byte = c;
+            write_shared_node(&byte, console_sfn, 0, 1);
+        }
+        g_uart->clear_rx_interrupt();
+
+        if(tx_ring != nullptr) {
+            start_tx();
         }
-        return -1;
     }
 
     void kputchars(const char* s, size_t n) {
-        if(s + n >= reinterpret_cast<char*>(KA_BEGIN)) {
+        if(tx_ring == nullptr) {
+            for(size_t i = 0; i < n; i++) {
+                kputchar(s[i]);
+            }
             return;
         }
 
         for(size_t i = 0; i < n; i++) {
-            kputchar(s[i]);
+            if(s[i] == '\n') {
+                push_tx_ring('\r');
+            }
+            push_tx_ring(s[i]);
         }
+        start_tx();
     }
 }
\ No newline at end of file
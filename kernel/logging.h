@@ -4,8 +4,17 @@
 #include "wwos/stdint.h"
 
 namespace wwos::kernel {
+    struct shared_file_node;
+
     void kputchar(char c);
+    // buffered, the uart transmit interrupt drains what does not fit in its fifo
+    void kputchars(const char* s, size_t n);
     int32_t kgetchar();
+
+    // received characters are queued in the /dev/console fifo by the uart interrupt
+    extern shared_file_node* console_sfn;
+    void initialize_console();
+    void on_console_interrupt();
 }
 
 #endif
\ No newline at end of file
@@ -8,10 +8,14 @@
 #include "drivers/pl011.h"
 
 #include "process.h"
+#include "procfs.h"
+#include "shared_memory.h"
+#include "logging.h"
 #include "filesystem.h"
 #include "memory.h"
 #include "global.h"
 #include "arch.h"
+#include "smp.h"
 
 
 extern wwos::uint64_t wwos_kernel_begin_mark;
@@ -81,17 +85,28 @@ void main(wwos::uint64_t pa_memdisk_begin, wwos::uint64_t pa_memdisk_end) {
 
     ttkernel->activate();
     setup_interrupt();
+    initialize_time();
+    enable_user_counter_access();
 
     g_uart = new pl011_driver(PA_UART_LOGGING + KA_BEGIN);
     g_uart->initialize();
 
     initialize_filesystem(reinterpret_cast<void*>(pa_memdisk_begin + KA_BEGIN), pa_memdisk_end - pa_memdisk_begin);
+    initialize_smp();
     initialize_process_subsystem();
+    initialize_shared_memory();
+    initialize_procfs();
     initialize_timer();
     initialize_logging();
+    initialize_console();
+    initialize_uart_interrupt();
 
-    create_process("/app/init");
+    auto init = create_process("/app/init");
+    wwassert(init, "failed to start init");
 
+    // secondary cpus wait on the lock until this cpu erets to init
+    g_kernel_lock.lock();
+    start_secondary_cpus();
 
     schedule();
     
@@ -98,4 +98,12 @@ void physical_memory_page_allocator::free(size_t addr) {
     }
 }
 
+size_t physical_memory_page_allocator::free_pages() {
+    size_t pages = 0;
+    for (auto& node : freelist) {
+        pages += node.size / page_size;
+    }
+    return pages;
+}
+
 }
@@ -19,6 +19,7 @@ public:
     size_t alloc(size_t n = 1);
     bool alloc_specific_page(size_t addr, size_t n = 1);
     void free(size_t addr);
+    size_t free_pages();
 
 private:
    vector<physical_page_node> freelist;
@@ -4,6 +4,7 @@
 #include "wwos/avl.h"
 #include "wwos/defs.h"
 #include "wwos/format.h"
+#include "wwos/hash_map.h"
 #include "wwos/map.h"
 #include "wwos/stdint.h"
 #include "wwos/stdio.h"
@@ -15,12 +16,16 @@
 #include "process.h"
 #include "global.h"
 #include "filesystem.h"
+#include "logging.h"
+#include "procfs.h"
 #include "arch.h"
+#include "smp.h"
 
 namespace wwos::kernel {
     
     struct clock_info {
-        int64_t semaphore_id;
+        int64_t semaphore_id;       // signalled on expiration, or -1
+        int64_t pid;                // woken on expiration if still blocked in the same poll, or -1
         uint64_t expiration_time;
 
         bool operator<(const clock_info& other) const {
@@ -28,13 +33,45 @@ namespace wwos::kernel {
         }
     };
 
-    scheduler* p_scheduler = nullptr;
-    map<uint64_t, semaphore*>* p_semaphores;
+    // what is left of an exited task until its parent waits for it
+    struct zombie_info {
+        int64_t parent_pid;
+        int64_t exit_code;
+    };
+
+    hash_map<uint64_t, semaphore*>* p_semaphores;
+    hash_map<uint64_t, message_queue*>* p_message_queues;
+    // tasks blocked in WAIT_ON_ADDRESS, by physical address of the word
+    hash_map<uint64_t, task_queue*>* p_futexes;
     map<uint64_t, task_info*>* p_tasks;
+    map<uint64_t, zombie_info>* p_zombies;
     avl_tree<clock_info>* p_clock_tree;
+    vector<int64_t>* p_pending_wakeups;
+
+    sched_group* p_root_group = nullptr;
 
     int64_t pid_counter = 0;
     int64_t semaphore_counter = 0;
+    int64_t message_queue_counter = 0;
+    uint64_t sched_group_counter = 0;
+
+    scheduler* this_scheduler() {
+        return this_cpu().sched;
+    }
+
+    void join_sched_group(task_info* task, sched_group* group) {
+        task->group = group;
+        group->members++;
+    }
+
+    void leave_sched_group(task_info* task) {
+        auto group = task->group;
+        task->group = nullptr;
+        group->members--;
+        if(group->members == 0 && group != p_root_group) {
+            delete group;
+        }
+    }
 
     void load_program(translation_table_user& ttu, string_view binary) {
         // print binary size
@@ -65,28 +102,12 @@ namespace wwos::kernel {
 
             ttu.set_page(USERSPACE_STACK_TOP - translation_table_user::PAGE_SIZE, pa);
         }
-    }
-
-    void init_fifo_for_process(uint64_t pid) {
-        wwfmtlog("initing fifo for pid {}", pid);
-
-        auto proc = open_shared_file_node(0, "/proc", fd_mode::READONLY);
-        if(proc == nullptr) {
-            create_shared_file_node("/proc", fd_type::DIRECTORY);
-        } else {
-            close_shared_file_node(0, proc);
-        }
-
-        wwlog("proc folder exists");
 
-        create_shared_file_node(format("/proc/{}", pid), fd_type::DIRECTORY);
-        create_shared_file_node(format("/proc/{}/fifo", pid), fd_type::DIRECTORY);
-        create_shared_file_node(format("/proc/{}/fifo/stdin", pid), fd_type::FIFO);
-        create_shared_file_node(format("/proc/{}/fifo/stdout", pid), fd_type::FIFO);
+        ttu.set_page(USERSPACE_TIME_PAGE, get_time_page_pa(), true);
     }
 
     void fork_current_task() {
-        auto parent = p_scheduler->get_executing_task();
+        auto parent = this_scheduler()->get_executing_task();
         wwassert(parent != nullptr, "Invalid parent pid");
 
         wwfmtlog("forking. parent={}\n", parent->pid);
@@ -104,16 +125,17 @@ namespace wwos::kernel {
         task_info* task = new task_info {
             .pid = uint64_t(pid_counter++),
             .pcb = {
-                .pc = parent->pcb.pc,
                 .ksp = KA_BEGIN + kernel_stack + KERNEL_STACK_SIZE,
-                .usp = parent->pcb.usp,
-                .has_return_value = true,
-                .return_value = 0,
-                .state = parent->pcb.state,
                 .tt = translation_table_user(),  
             },
             .fd_counter = parent->fd_counter,
         };
+        // the child resumes from the same syscall, with 0 returned
+        task->pcb.frame() = parent->pcb.frame();
+        task->pcb.set_return_value(0);
+        join_sched_group(task, parent->group);
+        task->parent_pid = parent->pid;
+        parent->children.push_back(task->pid);
 
         wwfmtlog("forked. parent={}, child={}", parent->pid, task->pid);
         // copy fds, including stdin, stdout
@@ -134,12 +156,19 @@ namespace wwos::kernel {
         }
         task->fds = parent->fds;
 
-        init_fifo_for_process(task->pid);
+        procfs_add_process(task->pid);
 
         parent->pcb.set_return_value(task->pid);
 
         auto pages = parent->pcb.tt.get_all_pages();
         for(auto& [va, pa] : pages) {
+            if(va == USERSPACE_TIME_PAGE) {
+                task->pcb.tt.set_page(va, pa, true);
+                continue;
+            }
+            if(is_shared_memory(*parent, va)) {
+                continue;
+            }
             auto new_pa = pallocator->alloc();
             ttkernel->set_page(new_pa, new_pa);
             ttkernel->activate();
@@ -147,19 +176,26 @@ namespace wwos::kernel {
             memcpy(reinterpret_cast<void*>(new_va_kernel), reinterpret_cast<void*>(pa + KA_BEGIN), translation_table_kernel::PAGE_SIZE);
             task->pcb.tt.set_page(va, new_pa);
         }        
+        fork_shared_memory(*parent, *task);
         p_tasks->insert(task->pid, task);
-        p_scheduler->add_task(task);
+        this_scheduler()->add_task(task);
 
         wwfmtlog("forked. parent={}, child={}", parent->pid, task->pid);
     }
 
     void initialize_process_subsystem() {
-        p_scheduler = new scheduler();
-        p_semaphores = new map<uint64_t, semaphore*>();
+        p_semaphores = new hash_map<uint64_t, semaphore*>();
+        p_message_queues = new hash_map<uint64_t, message_queue*>();
+        p_futexes = new hash_map<uint64_t, task_queue*>();
         p_clock_tree = new avl_tree<clock_info>();
         p_tasks = new map<uint64_t, task_info*>();
+        p_zombies = new map<uint64_t, zombie_info>();
+        p_pending_wakeups = new vector<int64_t>();
         pid_counter = 0;
         semaphore_counter = 0;
+        message_queue_counter = 0;
+        sched_group_counter = 0;
+        p_root_group = new sched_group { .id = sched_group_counter++ };
     }
 
     int64_t create_semaphore(uint64_t init) {
@@ -174,7 +210,7 @@ namespace wwos::kernel {
             return -1;
         }
         auto s = p_semaphores->get(id);
-        if(s->waiting_tasks.size() > 0) {
+        if(!s->waiting_tasks.empty()) {
             return -2;
         }
         p_semaphores->remove(id);
@@ -183,41 +219,106 @@ namespace wwos::kernel {
     }
 
     void current_task_wait_semaphore(int64_t id) {
-        auto task = p_scheduler->get_executing_task();
+        auto task = this_scheduler()->get_executing_task();
         wwassert(task != nullptr, "no executing task");
 
-        if(!p_semaphores->contains(id)) {
+        auto found = p_semaphores->find(id);
+        if(found == nullptr) {
             task->pcb.set_return_value(-1);
             return;
         }
 
-        auto s = p_semaphores->get(id);
-
+        auto s = *found;
         if(s->count > 0) {
             s->count--;
         } else {
-            p_scheduler->remove_task(task);
-            s->waiting_tasks.push_back(task->pid);
+            sleep_on(s->waiting_tasks);
         }
     }
 
     bool signal_semaphore(semaphore* s, size_t count) {
-        if(s->count == ~0ull and s->waiting_tasks.size() == 0) {
+        if(s->count == ~0ull and s->waiting_tasks.empty()) {
             return false;
         }
 
-        while(count > 0 and s->waiting_tasks.size() > 0) {
-            auto task_pid = s->waiting_tasks.back();
-            s->waiting_tasks.pop_back();
-            auto task = p_tasks->get(task_pid);
-            task->pcb.set_return_value(0);
-            p_scheduler->add_task(task);
-            count--;
+        s->count += count - wake_n(s->waiting_tasks, count);
+
+        return true;
+    }
+
+    void enqueue_waiter(wait_queue& queue) {
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
+
+        // a task woken through another queue stays on this one. it is harmless,
+        // the restarted syscall checks again, but it must not pile up
+        if(queue.waiting_tasks.find(task->pid) == queue.waiting_tasks.end()) {
+            queue.waiting_tasks.push_back(task->pid);
         }
+    }
 
-        s->count += count;
+    void block_current_task() {
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
 
-        return true;
+        // ELR points past the SVC. all other registers are restored untouched
+        task->pcb.frame().elr -= 4;
+        task->waiting = true;
+        this_scheduler()->remove_task(task);
+    }
+
+    void wait_on(wait_queue& queue) {
+        enqueue_waiter(queue);
+        block_current_task();
+    }
+
+    void wake_up(wait_queue& queue) {
+        // deferred: this may run deep inside the filesystem or the kernel logger,
+        // where the scheduler must not be re-entered
+        for(auto pid: queue.waiting_tasks) {
+            p_pending_wakeups->push_back(pid);
+        }
+        queue.waiting_tasks.clear();
+    }
+
+    void sleep_on(task_queue& queue) {
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
+
+        task->sleep_link.task = task;
+        queue.push_back(task->sleep_link);
+        this_scheduler()->remove_task(task);
+    }
+
+    size_t wake_n(task_queue& queue, size_t count, uint64_t value) {
+        size_t woken = 0;
+        while(woken < count && !queue.empty()) {
+            auto task = queue.pop_front();
+            task->pcb.set_return_value(value);
+            this_scheduler()->wake_task(task);
+            woken++;
+        }
+        return woken;
+    }
+
+    size_t wake_all(task_queue& queue, uint64_t value) {
+        return wake_n(queue, queue.size(), value);
+    }
+
+    void run_pending_wakeups() {
+        while(p_pending_wakeups->size() > 0) {
+            auto pid = p_pending_wakeups->back();
+            p_pending_wakeups->pop_back();
+            if(!p_tasks->contains(pid)) {
+                continue;
+            }
+            // stale entries of tasks already woken, or since blocked on something else
+            auto task = p_tasks->get(pid);
+            if(task->waiting) {
+                task->waiting = false;
+                this_scheduler()->wake_task(task);
+            }
+        }
     }
 
     semaphore* get_semaphore(int64_t id) {
@@ -234,17 +335,17 @@ namespace wwos::kernel {
         return p_semaphores->get(id);
     }
 
-    void current_task_signal_semaphore(int64_t id) {
-        auto task = p_scheduler->get_executing_task();
+    void current_task_signal_semaphore(int64_t id, uint64_t count) {
+        auto task = this_scheduler()->get_executing_task();
         wwassert(task != nullptr, "no executing task");
 
-        if(!p_semaphores->contains(id)) {
+        auto found = p_semaphores->find(id);
+        if(found == nullptr) {
             task->pcb.set_return_value(-1);
             return;
         }
 
-        auto s = p_semaphores->get(id);
-        if(signal_semaphore(s)) {
+        if(signal_semaphore(*found, count)) {
             task->pcb.set_return_value(0);
         } else {
             task->pcb.set_return_value(-2);
@@ -252,7 +353,7 @@ namespace wwos::kernel {
     }
 
     void current_task_signal_semaphore_after_microseconds(int64_t id, uint64_t microseconds) {
-        auto task = p_scheduler->get_executing_task();
+        auto task = this_scheduler()->get_executing_task();
         wwassert(task != nullptr, "no executing task");
 
         if(!p_semaphores->contains(id)) {
@@ -261,48 +362,300 @@ namespace wwos::kernel {
         }
 
         task->pcb.set_return_value(0);
-        p_clock_tree->insert({id, get_cpu_time() + microseconds});
+        p_clock_tree->insert({id, -1, get_cpu_time() + microseconds});
     }
 
-    void signal_semaphore_by_clocks() {
+    void run_expired_clocks() {
         auto current_time = get_cpu_time();
         while(!p_clock_tree->empty() && p_clock_tree->smallest()->data.expiration_time <= current_time) {
             auto smallest = p_clock_tree->smallest();
-            auto id = smallest->data.semaphore_id;
+            auto clock = smallest->data;
             p_clock_tree->remove(smallest);
-            if(!p_semaphores->contains(id)) {
+
+            if(clock.pid >= 0) {
+                if(!p_tasks->contains(clock.pid)) {
+                    continue;
+                }
+                auto task = p_tasks->get(clock.pid);
+                if(task->waiting && task->poll_deadline == clock.expiration_time) {
+                    p_pending_wakeups->push_back(clock.pid);
+                }
                 continue;
             }
-            auto s = p_semaphores->get(id);
-            signal_semaphore(s); // discarded result
+
+            auto found = p_semaphores->find(clock.semaphore_id);
+            if(found == nullptr) {
+                continue;
+            }
+            signal_semaphore(*found); // discarded result
+        }
+    }
+
+    bool check_pointer_validity(uint64_t va, uint64_t size) {
+        // assure kernel space are not accessed
+        // TODO handle data abort (terminate corresponding task)
+
+        if(va >= KA_BEGIN) {
+            // in case of overflow
+            return false;
+        }
+        if(va + size >= KA_BEGIN) {
+            return false;
+        }
+
+        return true;
+    }
+
+    // a buffer the kernel stores into: the time page is read only at EL1 as well,
+    // and a store there would fault in the kernel
+    static bool check_output_pointer_validity(uint64_t va, uint64_t size) {
+        if(!check_pointer_validity(va, size)) {
+            return false;
+        }
+        return va + size <= USERSPACE_TIME_PAGE || va >= USERSPACE_TIME_PAGE + translation_table_user::PAGE_SIZE;
+    }
+
+    // the physical address behind a futex word of the executing task, which keys
+    // p_futexes: tasks sharing the page find each other whatever their mapping
+    static bool get_futex_key(task_info* task, uint32_t* addr, uint64_t& key) {
+        if((uint64_t)addr % sizeof(uint32_t) != 0 || !check_pointer_validity((uint64_t)addr, sizeof(uint32_t))) {
+            return false;
+        }
+        return task->pcb.tt.translate((uint64_t)addr, key);
+    }
+
+    void current_task_wait_on_address(uint32_t* addr, uint32_t expected) {
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
+
+        uint64_t key;
+        if(!get_futex_key(task, addr, key)) {
+            task->pcb.set_return_value(-1);
+            return;
+        }
+
+        // a waker needs the kernel lock too, so it cannot slip in between the
+        // check and the block
+        if(__atomic_load_n(addr, __ATOMIC_ACQUIRE) != expected) {
+            task->pcb.set_return_value(-2);
+            return;
+        }
+
+        auto waiters = p_futexes->find(key);
+        if(waiters == nullptr) {
+            waiters = &p_futexes->insert(key, new task_queue());
+        }
+        sleep_on(**waiters);
+    }
+
+    void current_task_wake_address(uint32_t* addr, uint64_t count) {
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
+
+        uint64_t key;
+        if(!get_futex_key(task, addr, key)) {
+            task->pcb.set_return_value(-1);
+            return;
+        }
+
+        size_t woken = 0;
+        auto waiters = p_futexes->find(key);
+        if(waiters != nullptr) {
+            auto queue = *waiters;
+            woken = wake_n(*queue, count);
+            if(queue->empty()) {
+                p_futexes->remove(key);
+                delete queue;
+            }
         }
+        task->pcb.set_return_value(woken);
     }
 
-    void create_process(string_view path, task_info* replacing) {
-        // 1. load program
-        // 2. add to process list
+    int64_t create_message_queue(uint64_t max_messages, uint64_t max_message_size) {
+        if(max_messages == 0 || max_messages > MQ_MAX_MESSAGES || max_message_size > MQ_MAX_MESSAGE_SIZE) {
+            return -1;
+        }
+        int64_t id = message_queue_counter++;
+        p_message_queues->insert(id, new message_queue { .max_messages = max_messages, .max_message_size = max_message_size });
+        return id;
+    }
 
+    static void free_message(queued_message* message) {
+        for(auto pa: message->pages) {
+            pallocator->free(pa);
+        }
+        delete message;
+    }
+
+    int64_t delete_message_queue(int64_t id) {
+        auto found = p_message_queues->find(id);
+        if(found == nullptr) {
+            return -1;
+        }
+        auto q = *found;
+        if(q->senders.waiting_tasks.size() > 0 || q->receivers.waiting_tasks.size() > 0) {
+            return -2;
+        }
+        while(!q->messages.empty()) {
+            auto smallest = q->messages.smallest();
+            free_message(smallest->data.message);
+            q->messages.remove(smallest);
+        }
+        p_message_queues->remove(id);
+        delete q;
+        return 0;
+    }
+
+    // whole heap pages, all present: their frames can change owner instead of
+    // being copied
+    static bool can_hand_over_pages(task_info* task, uint64_t va, size_t size) {
+        constexpr uint64_t PAGE_SIZE = translation_table_user::PAGE_SIZE;
+        if(size < PAGE_SIZE || size % PAGE_SIZE != 0 || va % PAGE_SIZE != 0) {
+            return false;
+        }
+        if(va < USERSPACE_HEAP || va >= USERSPACE_HEAP_END || size > USERSPACE_HEAP_END - va) {
+            return false;
+        }
+        for(uint64_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            uint64_t pa;
+            if(!task->pcb.tt.translate(va + offset, pa)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void current_task_send_message(int64_t id, uint8_t* buffer, size_t size, uint64_t priority, uint64_t flags) {
+        constexpr uint64_t PAGE_SIZE = translation_table_user::PAGE_SIZE;
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
+
+        auto found = p_message_queues->find(id);
+        if(found == nullptr) {
+            task->pcb.set_return_value(-1);
+            return;
+        }
+        auto q = *found;
+        if(!check_pointer_validity((uint64_t)buffer, size)) {
+            task->pcb.set_return_value(-2);
+            return;
+        }
+        if(size > q->max_message_size) {
+            task->pcb.set_return_value(-3);
+            return;
+        }
+        if(q->count >= q->max_messages) {
+            if(flags & MQ_NONBLOCK) {
+                task->pcb.set_return_value(FD_WOULD_BLOCK);
+            } else {
+                wait_on(q->senders);
+            }
+            return;
+        }
+
+        auto message = new queued_message { .priority = priority, .size = size };
+        if(can_hand_over_pages(task, (uint64_t)buffer, size)) {
+            // the sender keeps a valid, zeroed buffer in place of the frames it gave away
+            for(uint64_t offset = 0; offset < size; offset += PAGE_SIZE) {
+                uint64_t pa;
+                task->pcb.tt.translate((uint64_t)buffer + offset, pa);
+                message->pages.push_back(pa);
+
+                auto new_pa = pallocator->alloc();
+                ttkernel->set_page(new_pa, new_pa);
+                ttkernel->activate();
+                memset(reinterpret_cast<void*>(KA_BEGIN + new_pa), 0, PAGE_SIZE);
+                task->pcb.tt.set_page((uint64_t)buffer + offset, new_pa);
+            }
+            task->pcb.tt.activate();
+        } else {
+            message->data = vector<uint8_t>(size);
+            memcpy(message->data.data(), buffer, size);
+        }
+
+        q->messages.insert({ priority, q->sequence++, message });
+        q->count++;
+        wake_up(q->receivers);
+        task->pcb.set_return_value(0);
+    }
+
+    void current_task_receive_message(int64_t id, uint8_t* buffer, size_t size, uint64_t* priority, uint64_t flags) {
+        constexpr uint64_t PAGE_SIZE = translation_table_user::PAGE_SIZE;
+        auto task = this_scheduler()->get_executing_task();
+        wwassert(task != nullptr, "no executing task");
+
+        auto found = p_message_queues->find(id);
+        if(found == nullptr) {
+            task->pcb.set_return_value(-1);
+            return;
+        }
+        auto q = *found;
+        if(!check_output_pointer_validity((uint64_t)buffer, size) || (priority != nullptr && !check_output_pointer_validity((uint64_t)priority, sizeof(uint64_t)))) {
+            task->pcb.set_return_value(-2);
+            return;
+        }
+        if(q->count == 0) {
+            if(flags & MQ_NONBLOCK) {
+                task->pcb.set_return_value(FD_WOULD_BLOCK);
+            } else {
+                wait_on(q->receivers);
+            }
+            return;
+        }
+
+        auto first = q->messages.smallest();
+        auto message = first->data.message;
+        if(message->size > size) {
+            task->pcb.set_return_value(-3);
+            return;
+        }
+        q->messages.remove(first);
+        q->count--;
+
+        if(message->pages.size() > 0 && can_hand_over_pages(task, (uint64_t)buffer, message->size)) {
+            // the frames move in, the receiver's own go back to the allocator
+            for(size_t i = 0; i < message->pages.size(); i++) {
+                uint64_t old_pa;
+                task->pcb.tt.translate((uint64_t)buffer + i * PAGE_SIZE, old_pa);
+                pallocator->free(old_pa);
+                task->pcb.tt.set_page((uint64_t)buffer + i * PAGE_SIZE, message->pages[i]);
+            }
+            task->pcb.tt.activate();
+            message->pages.clear();
+        } else if(message->pages.size() > 0) {
+            for(size_t i = 0; i < message->pages.size(); i++) {
+                memcpy(buffer + i * PAGE_SIZE, reinterpret_cast<void*>(KA_BEGIN + message->pages[i]), PAGE_SIZE);
+            }
+        } else {
+            memcpy(buffer, message->data.data(), message->size);
+        }
+
+        if(priority != nullptr) {
+            *priority = message->priority;
+        }
+        wake_up(q->senders);
+        task->pcb.set_return_value(message->size);
+        free_message(message);
+    }
+
+    // builds a task from the binary at path, with a fresh address space and
+    // kernel stack but no pid, fds or group yet. nullptr if it cannot be read
+    task_info* load_process(string_view path) {
         auto sfn = open_shared_file_node(0, path, fd_mode::READONLY);
-        if(replacing != nullptr && sfn == nullptr) {
+        if(sfn == nullptr) {
             wwlog("failed to open file\n");
-            replacing->pcb.set_return_value(-1);
-            return;
+            return nullptr;
         }
-        wwassert(sfn, "failed to open file");
         
         auto size = get_shared_node_size(sfn);
         vector<uint8_t> binary(size);
         
         auto ret = read_shared_node(binary.data(), sfn, 0, size);
-        if(ret != size && replacing != nullptr) {
+        close_shared_file_node(0, sfn);
+        if(ret != size) {
             wwlog("failed to read file\n");
-            close_shared_file_node(0, sfn);
-            replacing->pcb.set_return_value(-1);
-            return;
+            return nullptr;
         }
-        wwassert(ret == size, "failed to read file");
-
-        close_shared_file_node(0, sfn);
 
         auto kernel_stack = pallocator->alloc(KERNEL_STACK_SIZE / translation_table_kernel::PAGE_SIZE);
         for(size_t i = 0; i < KERNEL_STACK_SIZE; i += translation_table_kernel::PAGE_SIZE) {
@@ -310,38 +663,113 @@ namespace wwos::kernel {
         }
         ttkernel->activate();
 
-        uint64_t pid = replacing == nullptr ? pid_counter++ : replacing->pid;
-
         task_info* task = new task_info {
-            .pid = pid,
             .pcb = {
-                .pc = USERSPACE_TEXT,
                 .ksp = KA_BEGIN + kernel_stack + KERNEL_STACK_SIZE,
-                .usp = USERSPACE_STACK_TOP,
-                .has_return_value = false,
-                .return_value = 0,
-                .state = process_state(),
                 .tt = translation_table_user(),  
             }
         };
+        task->pcb.frame() = trap_frame { .elr = USERSPACE_TEXT, .sp_el0 = USERSPACE_STACK_TOP };
 
         load_program(task->pcb.tt, binary);
+        return task;
+    }
 
-        if(replacing == nullptr) {
-            init_fifo_for_process(pid);
+    task_info* create_process(string_view path, task_info* replacing) {
+        auto task = load_process(path);
+        if(task == nullptr) {
+            if(replacing != nullptr) {
+                replacing->pcb.set_return_value(-1);
+            }
+            return nullptr;
         }
 
+        uint64_t pid = replacing == nullptr ? pid_counter++ : replacing->pid;
+        task->pid = pid;
+
         if(replacing != nullptr) {
+            // the new image starts with no descriptors, release the old ones
+            for(auto& [fd, fd_info] : replacing->fds.items()) {
+                close_shared_file_node(pid, fd_info.node);
+            }
+            release_shared_memory(*replacing);
+            // it is still the same process to its parent and children
+            task->parent_pid = replacing->parent_pid;
+            task->children = replacing->children;
             p_tasks->update(pid, task);
-            p_scheduler->replace_task(replacing, task);
+            this_scheduler()->replace_task(replacing, task);
         } else {
+            procfs_add_process(pid);
+            join_sched_group(task, p_root_group);
             p_tasks->insert(pid, task);
-            p_scheduler->add_task(task);
+            this_scheduler()->add_task(task);
         }
+        return task;
+    }
+
+    void current_task_spawn(string_view path, spawn_fd_action* actions, size_t count, uint64_t flags) {
+        auto parent = this_scheduler()->get_executing_task();
+        wwassert(parent != nullptr, "no executing task");
+
+        if(count > SPAWN_MAX_FD_ACTIONS || !check_pointer_validity((uint64_t)actions, count * sizeof(spawn_fd_action))) {
+            parent->pcb.set_return_value(-1);
+            return;
+        }
+
+        int64_t fd_counter = 0;
+        for(size_t i = 0; i < count; i++) {
+            if(actions[i].child_fd < 0 || !parent->fds.contains(actions[i].parent_fd)) {
+                parent->pcb.set_return_value(-2);
+                return;
+            }
+            for(size_t j = 0; j < i; j++) {
+                if(actions[j].child_fd == actions[i].child_fd) {
+                    parent->pcb.set_return_value(-2);
+                    return;
+                }
+            }
+            fd_counter = max(fd_counter, actions[i].child_fd + 1);
+        }
+
+        // unlike fork + exec, nothing of the parent's address space is copied
+        auto task = load_process(path);
+        if(task == nullptr) {
+            parent->pcb.set_return_value(-3);
+            return;
+        }
+
+        task->pid = pid_counter++;
+        task->parent_pid = parent->pid;
+        parent->children.push_back(task->pid);
+
+        for(size_t i = 0; i < count; i++) {
+            auto fd_info = parent->fds.get(actions[i].parent_fd);
+            if(fd_info.mode == fd_mode::READONLY) {
+                fd_info.node->readers.push_back(task->pid);
+            } else {
+                fd_info.node->writers.push_back(task->pid);
+            }
+            task->fds.insert(actions[i].child_fd, fd_info);
+        }
+        task->fd_counter = fd_counter;
+
+        procfs_add_process(task->pid);
+
+        if(flags & SPAWN_NEW_SCHED_GROUP) {
+            join_sched_group(task, new sched_group { .id = sched_group_counter++ });
+        } else {
+            join_sched_group(task, parent->group);
+        }
+
+        p_tasks->insert(task->pid, task);
+        this_scheduler()->add_task(task);
+
+        wwfmtlog("spawned {} from {}", task->pid, parent->pid);
+        parent->pcb.set_return_value(task->pid);
     }
 
     void replace_current_task(string_view path) {
-        auto task = p_scheduler->get_executing_task();
+        auto task = this_scheduler()->get_executing_task();
         wwassert(task != nullptr, "Invalid pid");
 
         wwfmtlog("replacing {} with {}", task->pid, path);
@@ -350,32 +778,65 @@ namespace wwos::kernel {
 
         wwfmtlog("replaced {} with {}", task->pid, path);
 
-        wwassert(p_scheduler->get_executing_task() != nullptr, "no executing task");
+        wwassert(this_scheduler()->get_executing_task() != nullptr, "no executing task");
     }
 
     [[noreturn]] void schedule() {
-        signal_semaphore_by_clocks();
+        run_expired_clocks();
+        run_pending_wakeups();
 
-        auto task = p_scheduler->schedule();
-        wwassert(task != nullptr, "no task to schedule");
+        auto task = this_scheduler()->schedule();
+        if(task == nullptr) {
+            task = steal_task();
+        }
+        if(task == nullptr) {
+            idle();
+        }
 
         // dump ret
 #ifdef WWOS_LOG_ERET
-        wwfmtlog("ret?={}, ret_value={}", task->pcb.has_return_value, task->pcb.return_value);
-        wwfmtlog("scheduled. eret to unprivileged. pid={}, pc={:x} usp={:x}", task->pid, task->pcb.pc, task->pcb.usp);
+        wwfmtlog("scheduled. eret to unprivileged. pid={}, x0={:x}, pc={:x} usp={:x}", task->pid, task->pcb.frame().registers[0], task->pcb.frame().elr, task->pcb.frame().sp_el0);
 #endif
         task->pcb.tt.activate();
         set_timeout_interrupt(10000);
+        account_trap_exit(*task);
 
-        eret_to_unprivileged(
-            task->pcb.pc, task->pcb.usp, task->pcb.ksp, task->pcb.state, 
-            task->pcb.has_return_value, task->pcb.return_value);
+        // a switch is only a change of kernel stack, the frame is restored from there
+        eret_to_unprivileged(task->pcb.ksp);
 
         __builtin_unreachable();
     }
 
+    void account_trap_entry(task_info& task) {
+        auto now = get_cpu_time();
+        if(task.user_entered_at != 0) {
+            task.usage.user_time += now - task.user_entered_at;
+            task.user_entered_at = 0;
+        }
+        task.trap_entered_at = now;
+    }
+
+    void account_trap_exit(task_info& task) {
+        auto now = get_cpu_time();
+        if(task.trap_entered_at != 0) {
+            task.usage.system_time += now - task.trap_entered_at;
+            task.trap_entered_at = 0;
+        }
+        task.user_entered_at = now;
+    }
+
+    void preempt_if_needed() {
+        run_pending_wakeups();
+
+        // the executing task may also have blocked with nothing else runnable on this cpu
+        auto sched = this_scheduler();
+        if(sched->get_executing_task() == nullptr || sched->preemption_pending()) {
+            schedule();
+        }
+    }
+
     task_info& get_current_task() {
-        auto current_task = p_scheduler->get_executing_task();
+        auto current_task = this_scheduler()->get_executing_task();
         wwassert(current_task, "no executing task");
 
         return *current_task;
@@ -415,48 +876,35 @@ namespace wwos::kernel {
         return;
     }
 
-    bool check_pointer_validity(uint64_t va, uint64_t size) {
-        // assure kernel space are not accessed
-        // TODO handle data abort (terminate corresponding task)
-
-        if(va >= KA_BEGIN) {
-            // in case of overflow
-            return false;
-        }
-        if(va + size >= KA_BEGIN) {
-            return false;
-        }
-
-        return true;
-    }
-
-    void current_task_open(string_view path, fd_mode mode) {
-        auto current_task = p_scheduler->get_executing_task();
+    int64_t task_open(task_info* task, string_view path, fd_mode mode) {
         if(!check_pointer_validity((uint64_t)path.data(), path.size())) {
-            current_task->pcb.set_return_value(-1);
-            return;
+            return -1;
         }
 
-        wwfmtlog("trying to open {} with mode {}. by {}", path, static_cast<int>(mode), current_task->pid);
+        wwfmtlog("trying to open {} with mode {}. by {}", path, static_cast<int>(mode), task->pid);
         
-        auto sfn = open_shared_file_node(current_task->pid, path, mode);
+        auto sfn = open_shared_file_node(task->pid, path, mode);
         if(sfn == nullptr) {
-            current_task->pcb.set_return_value(-1);
-            return;
+            return -1;
         }
 
-        uint64_t fd = current_task->fd_counter++;
-        wwfmtlog("assigned fd {} for pid {}", fd, current_task->pid);
+        uint64_t fd = task->fd_counter++;
+        wwfmtlog("assigned fd {} for pid {}", fd, task->pid);
 
-        current_task->fds.insert(fd, fd_info {.node = sfn, .mode = mode, .offset = 0});
+        task->fds.insert(fd, fd_info {.node = sfn, .mode = mode, .offset = 0});
 
-        wwfmtlog("inserted fd {} for pid {}. mode={}", fd, current_task->pid, static_cast<int>(current_task->fds.get(fd).mode));
+        wwfmtlog("inserted fd {} for pid {}. mode={}", fd, task->pid, static_cast<int>(task->fds.get(fd).mode));
         
-        current_task->pcb.set_return_value(fd);
+        return fd;
+    }
+
+    void current_task_open(string_view path, fd_mode mode) {
+        auto current_task = this_scheduler()->get_executing_task();
+        current_task->pcb.set_return_value(task_open(current_task, path, mode));
     }
 
     void current_task_create(string_view path, fd_type type) {
-        auto current_task = p_scheduler->get_executing_task();
+        auto current_task = this_scheduler()->get_executing_task();
         if(!check_pointer_validity((uint64_t)path.data(), path.size())) {
             current_task->pcb.set_return_value(-1);
             return;
@@ -471,67 +919,152 @@ namespace wwos::kernel {
         current_task->pcb.set_return_value(0);
     }
 
-    void current_task_read(int64_t fd, uint8_t* buffer, size_t size) {
-        // wwlog("request read");
-        auto current_task = p_scheduler->get_executing_task();
-        wwassert(current_task, "no executing task");
-
-        if(!check_pointer_validity((uint64_t)buffer, size)) {
-            current_task->pcb.set_return_value(-1);
+    int64_t task_read(task_info* task, int64_t fd, uint8_t* buffer, size_t size) {
+        if(!check_output_pointer_validity((uint64_t)buffer, size)) {
             wwlog("invalid buffer");
-            return;
+            return -1;
         }
 
-        if(!current_task->fds.contains(fd)) {
-            current_task->pcb.set_return_value(-2);
-            wwfmtlog("invalid fd {} for pid {}", fd, current_task->pid);
-            return;
+        if(!task->fds.contains(fd)) {
+            wwfmtlog("invalid fd {} for pid {}", fd, task->pid);
+            return -2;
         }
 
-        auto& fd_info = current_task->fds.get(fd);
+        auto& fd_info = task->fds.get(fd);
         if(fd_info.mode != fd_mode::READONLY) {
-            current_task->pcb.set_return_value(-3);
-            wwfmtlog("invalid mode {} for pid {} fd {}", static_cast<int>(fd_info.mode), current_task->pid, fd);
-            return;
+            wwfmtlog("invalid mode {} for pid {} fd {}", static_cast<int>(fd_info.mode), task->pid, fd);
+            return -3;
         }
         
         if(fd_info.node->type == fd_type::DIRECTORY) {
-            current_task->pcb.set_return_value(-4);
-            wwfmtlog("invalid type {} for pid {} fd {}", static_cast<int>(fd_info.node->type), current_task->pid, fd);
-            return;
+            wwfmtlog("invalid type {} for pid {} fd {}", static_cast<int>(fd_info.node->type), task->pid, fd);
+            return -4;
         }
         
+        auto node = fd_info.node;
+        if(node->type == fd_type::FIFO && size > 0 && get_shared_node_size(node) == 0 && !fifo_at_eof(node)) {
+            return FD_WOULD_BLOCK;
+        }
+
         auto read_size = read_shared_node(buffer, fd_info.node, fd_info.offset, size);
         fd_info.offset += read_size;
-        
-        current_task->pcb.set_return_value(read_size);
+        return read_size;
     }
 
-    void current_task_write(int64_t fd, uint8_t* buffer, size_t size) {
-        auto current_task = p_scheduler->get_executing_task();
-        if(!check_pointer_validity((uint64_t)buffer, size)) {
-            current_task->pcb.set_return_value(-1);
+    void current_task_read(int64_t fd, uint8_t* buffer, size_t size) {
+        auto current_task = this_scheduler()->get_executing_task();
+        wwassert(current_task, "no executing task");
+
+        current_task->blocked_read.node = nullptr;
+        auto ret = task_read(current_task, fd, buffer, size);
+        if(ret == FD_WOULD_BLOCK && !current_task->fds.get(fd).nonblocking) {
+            current_task->blocked_read = { current_task->fds.get(fd).node, fd, (uint64_t)buffer, size };
+            wait_on(*get_fd_wait_queue(current_task, fd));
             return;
         }
+        current_task->pcb.set_return_value(ret);
+    }
 
-        if(!current_task->fds.contains(fd)) {
-            current_task->pcb.set_return_value(-2);
-            return;
+    // the first reader blocked in FD_READ on node takes what it can straight from
+    // the writer's buffer, and its read completes instead of being restarted.
+    // node must be empty, or the data would overtake what is buffered
+    static size_t hand_off_to_reader(shared_file_node* node, const uint8_t* buffer, size_t size) {
+        constexpr uint64_t PAGE_SIZE = translation_table_user::PAGE_SIZE;
+        auto& waiters = node->read_waiters.waiting_tasks;
+        for(auto it = waiters.begin(); it != waiters.end(); ++it) {
+            auto pid = *it;
+            if(!p_tasks->contains(pid)) {
+                continue;
+            }
+            auto reader = p_tasks->get(pid);
+            auto& read = reader->blocked_read;
+            if(!reader->waiting || read.node != node) {
+                continue;
+            }
+
+            // the reader's tables are not active: go through the kernel's view of its
+            // frames. that alias is writable whatever the reader's mapping says, so
+            // the copy stops at the first page the reader may not write
+            size_t copied = 0;
+            auto count = min(size, read.size);
+            while(copied < count) {
+                uint64_t pa;
+                bool writable;
+                if(!reader->pcb.tt.translate(read.buffer + copied, pa, writable) || !writable) {
+                    break;
+                }
+                auto chunk = min<size_t>(count - copied, PAGE_SIZE - (read.buffer + copied) % PAGE_SIZE);
+                memcpy(reinterpret_cast<void*>(KA_BEGIN + pa), buffer + copied, chunk);
+                copied += chunk;
+            }
+            if(copied == 0) {
+                continue;
+            }
+
+            reader->fds.get(read.fd).offset += copied;
+            reader->pcb.set_return_value(copied);
+            reader->pcb.frame().elr += 4;   // past the SVC block_current_task rewound to
+            read.node = nullptr;
+            waiters.erase(it);
+            p_pending_wakeups->push_back(pid);
+            return copied;
         }
+        return 0;
+    }
 
-        auto& fd_info = current_task->fds.get(fd);
+    int64_t task_write(task_info* task, int64_t fd, uint8_t* buffer, size_t size) {
+        if(!check_pointer_validity((uint64_t)buffer, size)) {
+            return -1;
+        }
+
+        if(!task->fds.contains(fd)) {
+            return -2;
+        }
+
+        auto& fd_info = task->fds.get(fd);
         if(fd_info.mode != fd_mode::WRITEONLY) {
-            current_task->pcb.set_return_value(-3);
-            return;
+            return -3;
+        }
+
+        auto node = fd_info.node;
+        if(node->type == fd_type::FIFO && size > 0 && get_fifo_space(node) == 0 && node->readers.size() > 0) {
+            return FD_WOULD_BLOCK;
         }
 
-        auto write_size = write_shared_node(buffer, fd_info.node, fd_info.offset, size);
+        size_t handed = 0;
+        if(node->type == fd_type::FIFO && get_shared_node_size(node) == 0) {
+            handed = hand_off_to_reader(node, buffer, size);
+        }
+
+        auto write_size = handed + write_shared_node(buffer + handed, fd_info.node, fd_info.offset, size - handed);
         fd_info.offset += write_size;
-        current_task->pcb.set_return_value(write_size);
+        return write_size;
+    }
+
+    void current_task_write(int64_t fd, uint8_t* buffer, size_t size) {
+        auto current_task = this_scheduler()->get_executing_task();
+
+        auto ret = task_write(current_task, fd, buffer, size);
+        if(ret == FD_WOULD_BLOCK && !current_task->fds.get(fd).nonblocking) {
+            wait_on(*get_fd_wait_queue(current_task, fd));
+            return;
+        }
+        current_task->pcb.set_return_value(ret);
+    }
+
+    wait_queue* get_fd_wait_queue(task_info* task, int64_t fd) {
+        if(!task->fds.contains(fd)) {
+            return nullptr;
+        }
+        auto& fd_info = task->fds.get(fd);
+        if(fd_info.node->type != fd_type::FIFO) {
+            return nullptr;
+        }
+        return fd_info.mode == fd_mode::READONLY ? &fd_info.node->read_waiters : &fd_info.node->write_waiters;
     }
 
     void current_task_seek(int64_t fd, int64_t offset) {
-        auto current_task = p_scheduler->get_executing_task();
+        auto current_task = this_scheduler()->get_executing_task();
         if(!current_task->fds.contains(fd)) {
             current_task->pcb.set_return_value(-1);
             return;
@@ -548,12 +1081,17 @@ namespace wwos::kernel {
     }
 
     void current_task_stat(int64_t fd, fd_stat* stat) {
-        auto current_task = p_scheduler->get_executing_task();
-        if(!current_task->fds.contains(fd)) {
+        auto current_task = this_scheduler()->get_executing_task();
+        if(!check_output_pointer_validity((uint64_t)stat, sizeof(fd_stat))) {
             current_task->pcb.set_return_value(-1);
             return;
         }
 
+        if(!current_task->fds.contains(fd)) {
+            current_task->pcb.set_return_value(-2);
+            return;
+        }
+
         auto& fd_info = current_task->fds.get(fd);
         stat->size = get_shared_node_size(fd_info.node);
         stat->type = fd_info.node->type;
@@ -561,8 +1099,8 @@ namespace wwos::kernel {
     }
 
     void current_task_get_children(int64_t fd, char* buffer, size_t size) {
-        auto current_task = p_scheduler->get_executing_task();
-        if(!check_pointer_validity((uint64_t)buffer, size)) {
+        auto current_task = this_scheduler()->get_executing_task();
+        if(!check_output_pointer_validity((uint64_t)buffer, size)) {
             current_task->pcb.set_return_value(-1);
             return;
         }
@@ -582,36 +1120,219 @@ namespace wwos::kernel {
         current_task->pcb.set_return_value(flatten_children);
     }
 
+    int64_t task_close(task_info* task, int64_t fd) {
+        if(!task->fds.contains(fd)) {
+            return -1;
+        }
+        
+        auto& fd_info = task->fds.get(fd);
+        close_shared_file_node(task->pid, fd_info.node);
+
+        task->fds.remove(fd);
+        return 0;
+    }
+
     void current_task_close(int64_t fd) {
-        auto current_task = p_scheduler->get_executing_task();
+        auto current_task = this_scheduler()->get_executing_task();
+        current_task->pcb.set_return_value(task_close(current_task, fd));
+    }
+
+    void current_task_control(int64_t fd, fd_control op, uint64_t value) {
+        auto current_task = this_scheduler()->get_executing_task();
         if(!current_task->fds.contains(fd)) {
             current_task->pcb.set_return_value(-1);
             return;
         }
-        
-        auto& fd_info = current_task->fds.get(fd);
-        close_shared_file_node(current_task->pid, fd_info.node);
 
-        current_task->fds.remove(fd);
+        auto& fd_info = current_task->fds.get(fd);
+        if(op == fd_control::SET_NONBLOCKING) {
+            fd_info.nonblocking = value != 0;
+        } else if(op == fd_control::SET_FIFO_CAPACITY) {
+            if(fd_info.node->type != fd_type::FIFO || value == 0 || value > FIFO_MAX_CAPACITY) {
+                current_task->pcb.set_return_value(-1);
+                return;
+            }
+            set_fifo_capacity(fd_info.node, value);
+        } else {
+            current_task->pcb.set_return_value(-2);
+            return;
+        }
         current_task->pcb.set_return_value(0);
     }
 
-    void current_task_exit() {
-        auto current_task = p_scheduler->get_executing_task();
+    uint64_t get_fd_readiness(task_info* task, int64_t fd) {
+        if(!task->fds.contains(fd)) {
+            return POLL_INVALID;
+        }
+
+        auto& fd_info = task->fds.get(fd);
+        auto node = fd_info.node;
+        if(node->type != fd_type::FIFO) {
+            return fd_info.mode == fd_mode::READONLY ? POLL_READABLE : POLL_WRITABLE;
+        }
+
+        // mirrors the blocking conditions of current_task_read / current_task_write
+        uint64_t revents = 0;
+        if(fd_info.mode == fd_mode::READONLY) {
+            if(node->had_writer && node->writers.size() == 0) {
+                revents |= POLL_HANGUP;
+            }
+            if(get_shared_node_size(node) > 0 || fifo_at_eof(node)) {
+                revents |= POLL_READABLE;
+            }
+        } else {
+            if(node->readers.size() == 0) {
+                revents |= POLL_HANGUP | POLL_WRITABLE;
+            } else if(get_fifo_space(node) > 0) {
+                revents |= POLL_WRITABLE;
+            }
+        }
+        return revents;
+    }
+
+    int64_t task_poll(task_info* task, poll_fd* fds, size_t count) {
+        if(count > POLL_MAX_FDS) {
+            return -2;
+        }
+        if(!check_output_pointer_validity((uint64_t)fds, count * sizeof(poll_fd))) {
+            return -1;
+        }
+
+        int64_t ready = 0;
+        for(size_t i = 0; i < count; i++) {
+            fds[i].revents = get_fd_readiness(task, fds[i].fd) & (fds[i].events | POLL_HANGUP | POLL_INVALID);
+            if(fds[i].revents != 0) {
+                ready++;
+            }
+        }
+        return ready;
+    }
+
+    void enqueue_poll_waiters(task_info* task, poll_fd* fds, size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            auto queue = get_fd_wait_queue(task, fds[i].fd);
+            if(queue != nullptr) {
+                enqueue_waiter(*queue);
+            }
+        }
+    }
+
+    void current_task_poll(poll_fd* fds, size_t count, int64_t timeout) {
+        auto current_task = this_scheduler()->get_executing_task();
+        auto ready = task_poll(current_task, fds, count);
+        if(ready < 0) {
+            current_task->pcb.set_return_value(ready);
+            return;
+        }
+
+        // a blocked poll is restarted on every wakeup. the deadline set by the
+        // first attempt tells a restart apart from a new call
+        auto now = get_cpu_time();
+        bool timed_out = timeout == 0 || (current_task->poll_deadline != 0 && now >= current_task->poll_deadline);
+        if(ready > 0 || timed_out) {
+            current_task->poll_deadline = 0;
+            current_task->pcb.set_return_value(ready);
+            return;
+        }
+
+        if(timeout > 0 && current_task->poll_deadline == 0) {
+            current_task->poll_deadline = now + timeout;
+            p_clock_tree->insert({-1, int64_t(current_task->pid), current_task->poll_deadline});
+        }
+
+        enqueue_poll_waiters(current_task, fds, count);
+        block_current_task();
+    }
+
+    void current_task_getchar(bool nonblocking) {
+        auto current_task = this_scheduler()->get_executing_task();
+        auto c = kgetchar();
+        if(c < 0 && !nonblocking) {
+            wait_on(console_sfn->read_waiters);
+            return;
+        }
+        current_task->pcb.set_return_value(c);
+    }
+
+    void current_task_exit(int64_t code) {
+        auto current_task = this_scheduler()->get_executing_task();
         wwassert(current_task, "no executing task");
 
-        wwfmtlog("exiting pid {}", current_task->pid);
+        wwfmtlog("exiting pid {} with {}", current_task->pid, code);
 
         for(auto& [fd, fd_info] : current_task->fds.items()) {
             close_shared_file_node(current_task->pid, fd_info.node);
         }
+        release_shared_memory(*current_task);
+        procfs_remove_process(current_task->pid);
+
+        // nobody is left to wait for the children: the exited ones are reaped
+        // now, the running ones when they exit
+        for(auto child: current_task->children) {
+            if(p_tasks->contains(child)) {
+                p_tasks->get(child)->parent_pid = -1;
+            } else if(p_zombies->contains(child)) {
+                p_zombies->remove(child);
+            }
+        }
 
-        p_scheduler->remove_task(current_task);
+        auto parent_pid = current_task->parent_pid;
+        if(parent_pid >= 0 && p_tasks->contains(parent_pid)) {
+            p_zombies->insert(current_task->pid, { parent_pid, code });
+            wake_up(p_tasks->get(parent_pid)->child_exit_waiters);
+        }
+
+        // whatever ended the task, it must not stay linked on a semaphore or futex
+        // queue: the queue would point into the freed task_info
+        if(current_task->sleep_link.queue != nullptr) {
+            task_queue::remove(current_task->sleep_link);
+        }
+
+        this_scheduler()->remove_task(current_task);
         p_tasks->remove(current_task->pid);
+        leave_sched_group(current_task);
         delete current_task;
         schedule();
     }
 
+    void current_task_wait(int64_t pid, int64_t* status) {
+        auto current_task = this_scheduler()->get_executing_task();
+        if(status != nullptr && !check_output_pointer_validity((uint64_t)status, sizeof(int64_t))) {
+            current_task->pcb.set_return_value(-1);
+            return;
+        }
+
+        bool has_child = false;
+        int64_t exited = -1;
+        for(auto child: current_task->children) {
+            if(pid >= 0 && child != pid) {
+                continue;
+            }
+            has_child = true;
+            if(p_zombies->contains(child)) {
+                exited = child;
+                break;
+            }
+        }
+
+        if(!has_child) {
+            current_task->pcb.set_return_value(-2);
+            return;
+        }
+
+        if(exited < 0) {
+            wait_on(current_task->child_exit_waiters);
+            return;
+        }
+
+        if(status != nullptr) {
+            *status = p_zombies->get(exited).exit_code;
+        }
+        p_zombies->remove(exited);
+        current_task->children.erase(current_task->children.find(exited));
+        current_task->pcb.set_return_value(exited);
+    }
+
     void on_data_abort(uint64_t addr) {
         auto addr_aligned_down = align_down(addr, translation_table_user::PAGE_SIZE);
         if(addr_aligned_down >= USERSPACE_STACK_BOTTOM && addr_aligned_down <= USERSPACE_STACK_TOP) {
@@ -629,6 +1350,18 @@ namespace wwos::kernel {
         
     }
 
+    task_info* find_task(uint64_t pid) {
+        return p_tasks->contains(pid) ? p_tasks->get(pid) : nullptr;
+    }
+
+    vector<uint64_t> get_task_pids() {
+        vector<uint64_t> pids;
+        for(auto& [pid, task]: p_tasks->items()) {
+            pids.push_back(pid);
+        }
+        return pids;
+    }
+
     task_stat get_task_stat(uint64_t pid) {
         if(!p_tasks->contains(pid)) {
             if(pid < pid_counter) {
@@ -639,16 +1372,59 @@ namespace wwos::kernel {
         }
 
         auto task = p_tasks->get(pid);
-        if(p_scheduler->contains_task(task)) {
-            return task_stat::ACTIVE;
-        } else {
-            return task_stat::WAITING;
+        for(size_t i = 0; i < MAX_CPUS; i++) {
+            auto sched = get_cpu(i).sched;
+            if(sched->get_executing_task() == task || sched->contains_task(task)) {
+                return task_stat::ACTIVE;
+            }
+        }
+        return task_stat::WAITING;
+    }
+
+    void current_task_get_usage(uint64_t pid, task_usage* usage) {
+        auto current_task = this_scheduler()->get_executing_task();
+        if(!check_output_pointer_validity((uint64_t)usage, sizeof(task_usage))) {
+            current_task->pcb.set_return_value(-1);
+            return;
         }
+
+        if(!p_tasks->contains(pid)) {
+            current_task->pcb.set_return_value(-2);
+            return;
+        }
+
+        *usage = p_tasks->get(pid)->usage;
+        current_task->pcb.set_return_value(0);
     }
 
     void current_task_set_priority(uint64_t priority) {
-        auto current_task = p_scheduler->get_executing_task();
+        auto current_task = this_scheduler()->get_executing_task();
         current_task->priority = priority;
         current_task->pcb.set_return_value(0);
     }
+
+    void current_task_set_scheduler(sched_policy policy, uint64_t rt_priority) {
+        auto current_task = this_scheduler()->get_executing_task();
+        if(!this_scheduler()->set_policy(current_task, policy, rt_priority)) {
+            current_task->pcb.set_return_value(-1);
+            return;
+        }
+        current_task->pcb.set_return_value(0);
+    }
+
+    void current_task_create_sched_group(uint64_t weight) {
+        auto current_task = this_scheduler()->get_executing_task();
+        if(weight == 0 || weight > 0xffff) {
+            current_task->pcb.set_return_value(-1);
+            return;
+        }
+
+        // the executing task is not queued, so it can switch groups directly
+        auto group = new sched_group { .id = sched_group_counter++, .weight = uint16_t(weight) };
+        leave_sched_group(current_task);
+        join_sched_group(current_task, group);
+        current_task->vruntime = 0;
+
+        current_task->pcb.set_return_value(group->id);
+    }
 }
\ No newline at end of file
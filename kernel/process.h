@@ -5,6 +5,8 @@
 #include "aarch64/interrupt.h"
 #include "aarch64/memory.h"
 #include "filesystem.h"
+#include "shared_memory.h"
+#include "wwos/avl.h"
 #include "wwos/map.h"
 #include "wwos/stdint.h"
 #include "wwos/string_view.h"
@@ -13,18 +15,16 @@
 namespace wwos::kernel {
 
 struct process_control {
-    uint64_t pc;
-    uint64_t ksp;
-    uint64_t usp;
-    bool has_return_value;
-    uint64_t return_value;
-
-    process_state state;
+    uint64_t ksp;       // top of the kernel stack
     translation_table_user tt;
 
+    // the user registers, saved on trap entry and restored on return
+    trap_frame& frame() {
+        return *reinterpret_cast<trap_frame*>(ksp - sizeof(trap_frame));
+    }
+
     void set_return_value(uint64_t value) {
-        has_return_value = true;
-        return_value = value;
+        frame().registers[0] = value;
     }
 };
 
@@ -32,32 +32,105 @@ struct fd_info {
     shared_file_node* node;
     fd_mode mode;
     uint64_t offset;
+    bool nonblocking = false;
 };
 
+// a read blocked on an empty FIFO, for a writer to fill directly
+struct blocked_read_info {
+    shared_file_node* node = nullptr;   // nullptr unless blocked in FD_READ
+    int64_t fd;
+    uint64_t buffer;
+    size_t size;
+};
+
+struct sched_group;
+
 struct task_info {
     uint64_t vruntime = 0;
     uint16_t priority = 1000;
     uint64_t pid;
+
+    sched_policy policy = sched_policy::NORMAL;
+    uint16_t rt_priority = 0;
+    uint64_t rt_sequence = 0;       // FIFO order among equal rt priorities
+    uint64_t rt_slice_used = 0;     // round-robin time slice consumed, in microseconds
+
+    sched_group* group = nullptr;   // inherited across fork and exec
+
+    int64_t parent_pid = -1;        // -1 once the parent exited: the task is then reaped on exit
+    vector<int64_t> children;       // running, or exited and not waited for yet
+    wait_queue child_exit_waiters;  // the task itself, blocked in WAIT
+
+    // physical time of the last wakeup, 0 if the task is not waiting to run after one
+    uint64_t woken_at = 0;
+    uint64_t runnable_since = 0;    // when the task was last queued
+    uint64_t trap_entered_at = 0;   // when the task last entered the kernel, 0 while not in it
+    uint64_t user_entered_at = 0;   // when the task last returned to userspace
+
+    bool waiting = false;           // blocked on one or more wait queues
+    blocked_read_info blocked_read;
+    wait_link sleep_link;           // blocked on a semaphore or a futex word
+    uint64_t poll_deadline = 0;     // physical time a blocked poll gives up, 0 if none
+    task_usage usage = {};
     process_control pcb;
     
     uint64_t fd_counter = 0;
     map<uint64_t, fd_info> fds;
+
+    uint64_t io_ring_pa = 0;            // 0 if the task has no io_ring
+    vector<io_submission> io_pending;   // taken from the ring, waiting for their fd
+
+    vector<shm_mapping> shm_mappings;
 };
 
 struct semaphore {
     semaphore(int64_t count): count(count) {}
 
-    wwos::vector<int64_t> waiting_tasks;
+    task_queue waiting_tasks;
     int64_t count = 0;
     bool priviledged = false;
 };
 
+struct queued_message {
+    uint64_t priority;
+    size_t size;
+    vector<uint8_t> data;       // copied in, empty if the pages were handed over
+    vector<uint64_t> pages;     // frames taken from the sender, physical addresses
+};
+
+struct message_queue_entry {
+    uint64_t priority;
+    uint64_t sequence;          // FIFO among equal priorities
+    queued_message* message;
+
+    // the smallest entry is received first
+    bool operator<(const message_queue_entry& other) const {
+        if(priority != other.priority) {
+            return priority > other.priority;
+        }
+        return sequence < other.sequence;
+    }
+};
+
+struct message_queue {
+    size_t max_messages;
+    size_t max_message_size;
+    size_t count = 0;
+    uint64_t sequence = 0;
+    avl_tree<message_queue_entry> messages;
+    wait_queue senders;         // until a message is received from a full queue
+    wait_queue receivers;       // until a message is sent to an empty queue
+};
+
 extern uint64_t current_pid;
 
-void create_process(string_view path, task_info* replacing = nullptr);
+// returns the new task, nullptr if path cannot be loaded
+task_info* create_process(string_view path, task_info* replacing = nullptr);
 void replace_current_task(string_view path);
+void current_task_spawn(string_view path, spawn_fd_action* actions, size_t count, uint64_t flags);
 
 [[noreturn]] void schedule();
+void preempt_if_needed();
 
 void initialize_process_subsystem();
 
@@ -69,10 +142,21 @@ void fork_current_task();
 
 void kallocate_page(uint64_t va);
 
-void current_task_exit();
+void current_task_exit(int64_t code);
+void current_task_wait(int64_t pid, int64_t* status);
 void on_data_abort(uint64_t addr);
+// nullptr if no running task has pid
+task_info* find_task(uint64_t pid);
+vector<uint64_t> get_task_pids();
 task_stat get_task_stat(uint64_t pid);
+void current_task_get_usage(uint64_t pid, task_usage* usage);
+
+// cpu time accounting around traps
+void account_trap_entry(task_info& task);
+void account_trap_exit(task_info& task);
 void current_task_set_priority(uint64_t priority);
+void current_task_set_scheduler(sched_policy policy, uint64_t rt_priority);
+void current_task_create_sched_group(uint64_t weight);
 
 // semaphore
 int64_t create_semaphore(uint64_t init);
@@ -80,9 +164,40 @@ int64_t delete_semaphore(int64_t id);
 bool signal_semaphore(semaphore* s, size_t count = 1);
 semaphore* get_semaphore(int64_t id);
 void current_task_wait_semaphore(int64_t id);
-void current_task_signal_semaphore(int64_t id);
+// count at once: the oldest count waiters are woken, the rest goes to the count
+void current_task_signal_semaphore(int64_t id, uint64_t count);
 void current_task_signal_semaphore_after_microseconds(int64_t id, uint64_t microseconds);
 
+// message queue
+int64_t create_message_queue(uint64_t max_messages, uint64_t max_message_size);
+int64_t delete_message_queue(int64_t id);
+void current_task_send_message(int64_t id, uint8_t* buffer, size_t size, uint64_t priority, uint64_t flags);
+void current_task_receive_message(int64_t id, uint8_t* buffer, size_t size, uint64_t* priority, uint64_t flags);
+
+// futex: blocks while *addr == expected, until WAKE_ADDRESS on the same word
+void current_task_wait_on_address(uint32_t* addr, uint32_t expected);
+void current_task_wake_address(uint32_t* addr, uint64_t count);
+
+// wait queue
+// blocks the executing task and rewinds it to the syscall instruction, so the
+// syscall is issued again once the task is woken up.
+void wait_on(wait_queue& queue);
+// the same, on several queues at once: enqueue on each, then block. the first
+// wake_up on any of them wakes the task
+void enqueue_waiter(wait_queue& queue);
+void block_current_task();
+// the woken tasks become runnable when the kernel is about to leave the trap
+void wake_up(wait_queue& queue);
+void run_pending_wakeups();
+
+// task queue
+// blocks the executing task on queue until a wake_n / wake_all hands it value
+// as the result of its syscall
+void sleep_on(task_queue& queue);
+// wake the oldest count sleepers, returns how many there were
+size_t wake_n(task_queue& queue, size_t count, uint64_t value = 0);
+size_t wake_all(task_queue& queue, uint64_t value = 0);
+
 // fd
 void current_task_open(string_view path, fd_mode mode);
 void current_task_create(string_view path, fd_type type);
@@ -92,6 +207,21 @@ void current_task_write(int64_t fd, uint8_t* buffer, size_t size);
 void current_task_seek(int64_t fd, int64_t offset);
 void current_task_stat(int64_t fd, fd_stat* stat);
 void current_task_close(int64_t fd);
+void current_task_control(int64_t fd, fd_control op, uint64_t value);
+void current_task_poll(poll_fd* fds, size_t count, int64_t timeout);
+void current_task_getchar(bool nonblocking);
+
+// the same operations on behalf of task, which must be the one whose tables are
+// active. they return the result instead of setting it, and FD_WOULD_BLOCK
+// instead of blocking
+int64_t task_open(task_info* task, string_view path, fd_mode mode);
+int64_t task_read(task_info* task, int64_t fd, uint8_t* buffer, size_t size);
+int64_t task_write(task_info* task, int64_t fd, uint8_t* buffer, size_t size);
+int64_t task_close(task_info* task, int64_t fd);
+int64_t task_poll(task_info* task, poll_fd* fds, size_t count);
+// the queue a blocked read or write on fd waits on, nullptr if it never blocks
+wait_queue* get_fd_wait_queue(task_info* task, int64_t fd);
+void enqueue_poll_waiters(task_info* task, poll_fd* fds, size_t count);
 }
 
 #endif
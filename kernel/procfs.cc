@@ -0,0 +1,235 @@
+#include "procfs.h"
+#include "global.h"
+#include "memory.h"
+#include "process.h"
+#include "vfs.h"
+
+#include "wwos/assert.h"
+#include "wwos/format.h"
+#include "wwos/hash_map.h"
+#include "wwos/stdio.h"
+
+namespace wwos::kernel {
+    enum class procfs_kind {
+        ROOT,
+        MEMINFO,
+        PROCESS,
+        STAT,
+        MEMORY,
+        FIFO_DIRECTORY,
+        FIFO
+    };
+
+    // ids: the root is 0 and meminfo 1. a process has (pid + 1) << 16, its stat,
+    // memory and fifo directory the next three, and its i-th FIFO 16 + i past it
+    constexpr int64_t PROCESS_SHIFT = 16;
+    constexpr int64_t FIRST_FIFO = 16;
+    constexpr size_t MAX_FIFOS = (1 << PROCESS_SHIFT) - FIRST_FIFO;
+
+    struct procfs_process {
+        vector<string> fifos;   // created ones are appended, so an index stays valid
+    };
+
+    hash_map<uint64_t, procfs_process*>* p_procfs_processes;
+    mount* p_procfs_mount;
+
+    static int64_t process_id(uint64_t pid) {
+        return static_cast<int64_t>(pid + 1) << PROCESS_SHIFT;
+    }
+
+    static uint64_t pid_of(int64_t id) {
+        return (id >> PROCESS_SHIFT) - 1;
+    }
+
+    static procfs_kind kind_of(int64_t id) {
+        if(id == 0) {
+            return procfs_kind::ROOT;
+        } else if(id == 1) {
+            return procfs_kind::MEMINFO;
+        }
+        auto offset = id & ((1 << PROCESS_SHIFT) - 1);
+        if(offset >= FIRST_FIFO) {
+            return procfs_kind::FIFO;
+        }
+        constexpr procfs_kind kinds[] = { procfs_kind::PROCESS, procfs_kind::STAT, procfs_kind::MEMORY, procfs_kind::FIFO_DIRECTORY };
+        wwassert(offset < 4, "invalid procfs id");
+        return kinds[offset];
+    }
+
+    static procfs_process* find_process(uint64_t pid) {
+        auto process = p_procfs_processes->find(pid);
+        return process != nullptr ? *process : nullptr;
+    }
+
+    static string_view state_name(uint64_t pid) {
+        return get_task_stat(pid) == task_stat::ACTIVE ? "running" : "waiting";
+    }
+
+    static string_view policy_name(sched_policy policy) {
+        if(policy == sched_policy::FIFO) {
+            return "fifo";
+        } else if(policy == sched_policy::ROUND_ROBIN) {
+            return "round_robin";
+        }
+        return "normal";
+    }
+
+    // rendered on every read, so readers always see the current values. empty
+    // once the task is gone
+    static string generate_content(int64_t id) {
+        auto kind = kind_of(id);
+        if(kind == procfs_kind::MEMINFO) {
+            return format("free_pages {}\npage_size {}\n", pallocator->free_pages(), translation_table_kernel::PAGE_SIZE);
+        }
+
+        auto pid = pid_of(id);
+        auto task = find_task(pid);
+        if(task == nullptr) {
+            return string();
+        }
+        if(kind == procfs_kind::STAT) {
+            auto& usage = task->usage;
+            return format("pid {}\nparent {}\nstate {}\npolicy {}\npriority {}\nrt_priority {}\n", pid, task->parent_pid, state_name(pid), policy_name(task->policy), task->priority, task->rt_priority)
+                + format("user_time {}\nsystem_time {}\nvoluntary_switches {}\ninvoluntary_switches {}\nwait_time {}\n", usage.user_time, usage.system_time, usage.voluntary_switches, usage.involuntary_switches, usage.wait_time);
+        }
+        return format("pages {}\nshared_mappings {}\nfds {}\n", task->pcb.tt.get_all_pages().size(), task->shm_mappings.size(), task->fds.size());
+    }
+
+    static int64_t procfs_get_root(mount* mnt) {
+        return 0;
+    }
+
+    static int64_t procfs_lookup(mount* mnt, int64_t dir, string_view name) {
+        auto kind = kind_of(dir);
+        if(kind == procfs_kind::ROOT) {
+            if(name == "meminfo") {
+                return 1;
+            }
+            int32_t pid;
+            if(!stoi(name, pid) || pid < 0 || find_process(pid) == nullptr) {
+                return -1;
+            }
+            return process_id(pid);
+        }
+
+        if(kind == procfs_kind::PROCESS) {
+            if(name == "stat") {
+                return dir + 1;
+            } else if(name == "memory") {
+                return dir + 2;
+            } else if(name == "fifo") {
+                return dir + 3;
+            }
+            return -1;
+        }
+
+        if(kind == procfs_kind::FIFO_DIRECTORY) {
+            auto process = find_process(pid_of(dir));
+            if(process == nullptr) {
+                return -1;
+            }
+            for(size_t i = 0; i < process->fifos.size(); i++) {
+                if(string_view(process->fifos[i]) == name) {
+                    return process_id(pid_of(dir)) + FIRST_FIFO + i;
+                }
+            }
+        }
+        return -1;
+    }
+
+    static int64_t procfs_create(mount* mnt, int64_t dir, string_view name, fd_type type) {
+        if(kind_of(dir) != procfs_kind::FIFO_DIRECTORY || type != fd_type::FIFO || procfs_lookup(mnt, dir, name) >= 0) {
+            return -1;
+        }
+        auto process = find_process(pid_of(dir));
+        if(process == nullptr || process->fifos.size() >= MAX_FIFOS) {
+            return -1;
+        }
+        process->fifos.push_back(string(name.data(), name.size()));
+        return process_id(pid_of(dir)) + FIRST_FIFO + process->fifos.size() - 1;
+    }
+
+    static fd_type procfs_get_type(mount* mnt, int64_t id) {
+        auto kind = kind_of(id);
+        if(kind == procfs_kind::ROOT || kind == procfs_kind::PROCESS || kind == procfs_kind::FIFO_DIRECTORY) {
+            return fd_type::DIRECTORY;
+        }
+        return kind == procfs_kind::FIFO ? fd_type::FIFO : fd_type::FILE;
+    }
+
+    static size_t procfs_get_size(mount* mnt, int64_t id) {
+        return procfs_get_type(mnt, id) == fd_type::FILE ? generate_content(id).size() : 0;
+    }
+
+    static vector<string> procfs_get_children(mount* mnt, int64_t dir) {
+        vector<string> children;
+        auto kind = kind_of(dir);
+        if(kind == procfs_kind::ROOT) {
+            children.push_back("meminfo");
+            for(auto pid: get_task_pids()) {
+                children.push_back(format("{}", pid));
+            }
+        } else if(kind == procfs_kind::PROCESS) {
+            children.push_back("fifo");
+            children.push_back("memory");
+            children.push_back("stat");
+        } else if(kind == procfs_kind::FIFO_DIRECTORY) {
+            auto process = find_process(pid_of(dir));
+            if(process != nullptr) {
+                children = process->fifos;
+            }
+        }
+        return children;
+    }
+
+    static size_t procfs_read(mount* mnt, int64_t id, size_t offset, size_t size, void* buffer) {
+        auto content = generate_content(id);
+        if(offset >= content.size()) {
+            return 0;
+        }
+        size = min<size_t>(size, content.size() - offset);
+        memcpy(buffer, content.data() + offset, size);
+        return size;
+    }
+
+    static void procfs_truncate(mount* mnt, int64_t id) {}
+
+    constexpr vfs_operations procfs_operations = {
+        .get_root = procfs_get_root,
+        .lookup = procfs_lookup,
+        .create = procfs_create,
+        .get_type = procfs_get_type,
+        .get_size = procfs_get_size,
+        .get_children = procfs_get_children,
+        .read = procfs_read,
+        .write = nullptr,
+        .truncate = procfs_truncate,
+        .cache_lookups = false,
+    };
+
+    void initialize_procfs() {
+        p_procfs_processes = new hash_map<uint64_t, procfs_process*>();
+        p_procfs_mount = mount_file_system("/proc", &procfs_operations, nullptr);
+    }
+
+    void procfs_add_process(uint64_t pid) {
+        auto process = new procfs_process();
+        process->fifos.push_back("stdin");
+        process->fifos.push_back("stdout");
+        p_procfs_processes->insert(pid, process);
+    }
+
+    void procfs_remove_process(uint64_t pid) {
+        auto process = find_process(pid);
+        if(process == nullptr) {
+            return;
+        }
+        p_procfs_processes->remove(pid);
+
+        // FIFOs still open elsewhere go with their last close
+        for(size_t i = 0; i < process->fifos.size(); i++) {
+            vfs_unlink(p_procfs_mount, process_id(pid) + FIRST_FIFO + i);
+        }
+        delete process;
+    }
+}
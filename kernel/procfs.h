@@ -0,0 +1,19 @@
+#ifndef _WWOS_KERNEL_PROCFS_H
+#define _WWOS_KERNEL_PROCFS_H
+
+#include "wwos/stdint.h"
+
+namespace wwos::kernel {
+    // /proc is generated from the task list, nothing of it is stored:
+    //   /proc/meminfo              free physical pages
+    //   /proc/<pid>/stat           scheduling state and cpu usage
+    //   /proc/<pid>/memory         mapped pages, shared memory mappings and fds
+    //   /proc/<pid>/fifo/<name>    in-memory FIFOs: stdin, stdout and any created there
+    void initialize_procfs();
+
+    // a process' FIFOs live until it exits and the last of them is closed
+    void procfs_add_process(uint64_t pid);
+    void procfs_remove_process(uint64_t pid);
+}
+
+#endif
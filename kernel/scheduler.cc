@@ -11,7 +11,10 @@ namespace wwos::kernel {
 
 
 bool task_info_ptr::operator<(const task_info_ptr& other) const {
-    return task->vruntime < other.task->vruntime;
+    if(task->vruntime != other.task->vruntime) {
+        return task->vruntime < other.task->vruntime;
+    }
+    return task->pid < other.task->pid;
 }
 
 void task_info_ptr::destroy() {
@@ -19,20 +22,101 @@ void task_info_ptr::destroy() {
     task = nullptr;
 }
 
+bool rt_task_info_ptr::operator<(const rt_task_info_ptr& other) const {
+    if(task->rt_priority != other.task->rt_priority) {
+        return task->rt_priority > other.task->rt_priority;
+    }
+    return task->rt_sequence < other.task->rt_sequence;
+}
+
+bool sched_group_ptr::operator<(const sched_group_ptr& other) const {
+    auto vruntime = group->rqs[cpu].vruntime;
+    auto other_vruntime = other.group->rqs[cpu].vruntime;
+    if(vruntime != other_vruntime) {
+        return vruntime < other_vruntime;
+    }
+    return group->id < other.group->id;
+}
+
+static bool is_rt(task_info* task) {
+    return task->policy != sched_policy::NORMAL;
+}
+
+sched_group_rq& scheduler::rq(sched_group* group) {
+    return group->rqs[cpu];
+}
+
+void scheduler::activate_group(sched_group* group) {
+    // a group coming back from idle must not carry a stale, small vruntime,
+    // otherwise it would monopolize the cpu until it catches up.
+    if(!active_groups.empty()) {
+        rq(group).vruntime = max(rq(group).vruntime, smallest_group_vruntime());
+    }
+    active_groups.insert(sched_group_ptr(group, cpu));
+}
+
+void scheduler::deactivate_group(sched_group* group) {
+    auto node = active_groups.find_exact(sched_group_ptr(group, cpu));
+    wwassert(node && group == node->data.operator->(), "group not found");
+    active_groups.remove(node);
+}
+
+uint64_t scheduler::smallest_group_vruntime() {
+    return max<uint64_t>(active_groups.smallest()->data->rqs[cpu].vruntime, 1) - 1;
+}
+
+void scheduler::enqueue(task_info* task) {
+    task->runnable_since = get_cpu_time();
+    queued++;
+
+    if(is_rt(task)) {
+        rt_tasks.insert(rt_task_info_ptr(task));
+        return;
+    }
+
+    auto group = task->group;
+    bool group_was_idle = rq(group).tasks.empty();
+    rq(group).tasks.insert(task_info_ptr(task));
+    if(group_was_idle) {
+        activate_group(group);
+    }
+}
+
+void scheduler::dequeue(task_info* task) {
+    queued--;
+    if(is_rt(task)) {
+        auto node = rt_tasks.find_exact(rt_task_info_ptr(task));
+        wwassert(node && task == node->data.operator->(), "task not found");
+        rt_tasks.remove(node);
+        return;
+    }
+
+    auto group = task->group;
+    auto node = rq(group).tasks.find_exact(task_info_ptr(task));
+    wwassert(node && task == node->data.operator->(), "task not found");
+    rq(group).tasks.remove(node);
+    if(rq(group).tasks.empty()) {
+        deactivate_group(group);
+    }
+}
+
 void scheduler::add_task(task_info* task) {
     wwassert(task, "task is null");
 
-    if(active_tasks.empty()) {
-        if(executing_task != nullptr) {
+    if(is_rt(task)) {
+        task->rt_sequence = rt_sequence_counter++;
+        task->rt_slice_used = 0;
+    } else if(rq(task->group).tasks.empty()) {
+        if(executing_task != nullptr && !is_rt(executing_task) && executing_task->group == task->group) {
             task->vruntime = max<uint64_t>(executing_task->vruntime, 1) - 1;
         } else {
             task->vruntime = 0;
         }
     } else {
-        task->vruntime = max<uint64_t>(active_tasks.smallest()->data->vruntime, 1) - 1;
+        task->vruntime = max<uint64_t>(rq(task->group).tasks.smallest()->data->vruntime, 1) - 1;
     }
 
-    active_tasks.insert(task_info_ptr(task));
+    enqueue(task);
     if(executing_task == nullptr) {
         schedule();
     }
@@ -40,13 +124,111 @@ void scheduler::add_task(task_info* task) {
     wwassert(executing_task != nullptr, "impossible");
 }
 
+void scheduler::wake_task(task_info* task) {
+    task->woken_at = get_cpu_time();
+    add_task(task);
+
+    if(should_preempt(task)) {
+        preempt = true;
+    }
+    if(queued > 0) {
+        kick_idle_cpu();
+    }
+}
+
+bool scheduler::should_preempt(task_info* woken) {
+    if(executing_task == nullptr || executing_task == woken) {
+        return false;
+    }
+
+    auto physical_time = get_cpu_time();
 
-        // void replace_task(task_info* task_to_delete, task_info* task_to_add);
+    if(is_rt(woken)) {
+        if(rt_throttled(physical_time)) {
+            return false;
+        }
+        return !is_rt(executing_task) || woken->rt_priority > executing_task->rt_priority;
+    }
+
+    if(is_rt(executing_task)) {
+        return false;
+    }
+
+    auto physical_time_spent = physical_time - physical_time_start;
+
+    if(woken->group != executing_task->group) {
+        auto group = executing_task->group;
+        auto executing_vruntime = rq(group).vruntime + physical_time_spent / group->weight;
+        auto granularity = max<uint64_t>(WAKEUP_GRANULARITY / group->weight, 1);
+        return rq(woken->group).vruntime + granularity < executing_vruntime;
+    }
+
+    auto executing_vruntime = executing_task->vruntime + physical_time_spent / executing_task->priority;
+    auto granularity = max<uint64_t>(WAKEUP_GRANULARITY / executing_task->priority, 1);
+
+    return woken->vruntime + granularity < executing_vruntime;
+}
+
+bool scheduler::preemption_pending() {
+    return preempt;
+}
+
+bool scheduler::rt_throttled(uint64_t physical_time) {
+    if(physical_time - rt_period_start >= RT_PERIOD) {
+        rt_period_start = physical_time;
+        rt_time_used = 0;
+    }
+    return rt_time_used >= RT_RUNTIME;
+}
+
+bool scheduler::set_policy(task_info* task, sched_policy policy, uint64_t rt_priority) {
+    if(policy == sched_policy::NORMAL) {
+        if(rt_priority != 0) {
+            return false;
+        }
+    } else if(policy == sched_policy::FIFO || policy == sched_policy::ROUND_ROBIN) {
+        if(rt_priority < RT_PRIORITY_MIN || rt_priority > RT_PRIORITY_MAX) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    bool queued = task != executing_task;
+    if(queued) {
+        dequeue(task);
+    }
+
+    if(is_rt(task) && policy == sched_policy::NORMAL) {
+        // do not let a demoted task starve the others with its stale vruntime
+        if(!rq(task->group).tasks.empty()) {
+            task->vruntime = max(task->vruntime, rq(task->group).tasks.smallest()->data->vruntime);
+        }
+    }
+
+    task->policy = policy;
+    task->rt_priority = rt_priority;
+    task->rt_slice_used = 0;
+
+    if(queued) {
+        // still waiting since it was first queued, not since now
+        auto runnable_since = task->runnable_since;
+        enqueue(task);
+        task->runnable_since = runnable_since;
+    }
+    return true;
+}
 
 void scheduler::replace_task(task_info* task_to_delete, task_info* task_to_add) {
     wwassert(task_to_delete, "task_to_delete is null");
     wwassert(task_to_add, "task_to_add is null");
 
+    task_to_add->policy = task_to_delete->policy;
+    task_to_add->rt_priority = task_to_delete->rt_priority;
+    task_to_add->rt_sequence = task_to_delete->rt_sequence;
+    task_to_add->rt_slice_used = task_to_delete->rt_slice_used;
+    task_to_add->group = task_to_delete->group;
+
     if(task_to_delete == executing_task) {
         task_to_add->vruntime = task_to_delete->vruntime;
         wwfmtlog("replacing executing task {}, vruntime = {}", task_to_add->pid, task_to_add->vruntime);
@@ -54,11 +236,17 @@ void scheduler::replace_task(task_info* task_to_delete, task_info* task_to_add)
         return;
     }
 
-    auto node = active_tasks.find(task_info_ptr(task_to_delete));
-    wwassert(task_to_delete == node->data.operator->(), "task not found");
     task_to_add->vruntime = task_to_delete->vruntime;
     wwfmtlog("replacing task {}, vruntime = {}", task_to_add->pid, task_to_add->vruntime);
-    node->data = task_info_ptr(task_to_add);
+    if(is_rt(task_to_delete)) {
+        auto node = rt_tasks.find_exact(rt_task_info_ptr(task_to_delete));
+        wwassert(node && task_to_delete == node->data.operator->(), "task not found");
+        node->data = rt_task_info_ptr(task_to_add);
+    } else {
+        auto node = rq(task_to_delete->group).tasks.find_exact(task_info_ptr(task_to_delete));
+        wwassert(node && task_to_delete == node->data.operator->(), "task not found");
+        node->data = task_info_ptr(task_to_add);
+    }
 }
 
 void scheduler::remove_task(task_info* task) {
@@ -67,58 +255,144 @@ void scheduler::remove_task(task_info* task) {
     }
 
     if(task == executing_task) {
+        task->usage.voluntary_switches++;
+        task->usage.system_time += get_cpu_time() - task->trap_entered_at;
+        task->trap_entered_at = 0;
         executing_task = nullptr;
         schedule();
         return;
     }
 
-    auto node = active_tasks.find(task_info_ptr(task));
-    wwassert(task == node->data.operator->(), "task not found");
-    active_tasks.remove(node);
+    dequeue(task);
 }
 
 task_info* scheduler::schedule() {
     auto physical_time = get_cpu_time();
+    preempt = false;
+
+    auto previous_task = executing_task;
 
     if(executing_task != nullptr) {
         auto physical_time_spent = physical_time - physical_time_start;
-        auto virtual_time_spent = max<uint64_t>(physical_time_spent / executing_task->priority, 1);
-        executing_task->vruntime += virtual_time_spent;
+
+        if(is_rt(executing_task)) {
+            rt_time_used += physical_time_spent;
+            executing_task->rt_slice_used += physical_time_spent;
+            if(executing_task->policy == sched_policy::ROUND_ROBIN && executing_task->rt_slice_used >= RR_TIMESLICE) {
+                // go to the back of its priority level
+                executing_task->rt_sequence = rt_sequence_counter++;
+                executing_task->rt_slice_used = 0;
+            }
+#ifdef WWOS_LOG_SCHEDULER
+            wwfmtlog("rt task {} spent {} physical time", executing_task->pid, physical_time_spent);
+#endif
+        } else {
+            auto virtual_time_spent = max<uint64_t>(physical_time_spent / executing_task->priority, 1);
+            executing_task->vruntime += virtual_time_spent;
+
+            // the group's key changes, so take it out of the tree while charging it
+            auto group = executing_task->group;
+            bool group_active = !rq(group).tasks.empty();
+            if(group_active) {
+                deactivate_group(group);
+            }
+            rq(group).vruntime += max<uint64_t>(physical_time_spent / group->weight, 1);
+            if(group_active) {
+                active_groups.insert(sched_group_ptr(group, cpu));
+            }
 #ifdef WWOS_LOG_SCHEDULER
-        wwfmtlog("task {} spent {} physical time, {} virtual time", executing_task->pid, physical_time_spent, virtual_time_spent);
-        wwfmtlog("task {} updated to vruntime = {}", executing_task->pid, executing_task->vruntime);
+            wwfmtlog("task {} spent {} physical time, {} virtual time", executing_task->pid, physical_time_spent, virtual_time_spent);
+            wwfmtlog("task {} updated to vruntime = {}", executing_task->pid, executing_task->vruntime);
 #endif
-        active_tasks.insert(task_info_ptr(executing_task));
+        }
+        enqueue(executing_task);
         executing_task = nullptr;
     }
 
-    if(!active_tasks.empty()) {
-        auto next_task_node = active_tasks.smallest();
-        if(next_task_node == nullptr) {
-            return nullptr;
+    // rt tasks run ahead of CFS unless they used up their bandwidth in this period.
+    // a throttled rt task still runs when there is nothing else to do.
+    bool pick_rt = !rt_tasks.empty() && (!rt_throttled(physical_time) || active_groups.empty());
+
+    if(pick_rt) {
+        executing_task = rt_tasks.smallest()->data.operator->();
+    } else if(!active_groups.empty()) {
+        executing_task = rq(active_groups.smallest()->data.operator->()).tasks.smallest()->data.operator->();
+    }
+
+    if(executing_task != nullptr) {
+        dequeue(executing_task);
+    }
+
+    physical_time_start = physical_time;
+
+    if(previous_task != nullptr && previous_task != executing_task) {
+        // the previous task was preempted while in the kernel on its behalf
+        previous_task->usage.involuntary_switches++;
+        if(previous_task->trap_entered_at != 0) {
+            previous_task->usage.system_time += physical_time - previous_task->trap_entered_at;
+            previous_task->trap_entered_at = 0;
         }
+    }
 
-        executing_task = next_task_node->data.operator->();
-        active_tasks.remove(next_task_node);
-        physical_time_start = physical_time;
+    if(executing_task == nullptr) {
+        // nothing runnable on this cpu, the caller idles or steals work
+        return nullptr;
+    }
 
-        wwassert(executing_task, "no task to schedule");
+    if(previous_task != executing_task) {
+        auto& usage = executing_task->usage;
+        auto waited = physical_time - executing_task->runnable_since;
+        usage.wait_time += waited;
+        usage.max_latency = max(usage.max_latency, waited);
 
+        // it resumes inside the kernel, on its way back to userspace
+        executing_task->trap_entered_at = physical_time;
+    }
+
+    if(executing_task->woken_at != 0) {
+        auto& usage = executing_task->usage;
+        usage.wakeup_latency = physical_time - executing_task->woken_at;
+        usage.max_wakeup_latency = max(usage.max_wakeup_latency, usage.wakeup_latency);
+        executing_task->woken_at = 0;
 #ifdef WWOS_LOG_SCHEDULER
-        wwfmtlog("scheduled task {}, vruntime = {}", executing_task->pid, executing_task->vruntime);
+        wwfmtlog("task {} waited {} after wakeup", executing_task->pid, usage.wakeup_latency);
 #endif
-        return executing_task;
     }
 
-    wwassert(false, "no task to schedule.");
+#ifdef WWOS_LOG_SCHEDULER
+    wwfmtlog("scheduled task {}, vruntime = {}", executing_task->pid, executing_task->vruntime);
+#endif
+    return executing_task;
 }
 
 task_info* scheduler::get_executing_task() {
     return executing_task;
 }
 
+size_t scheduler::queued_count() {
+    return queued;
+}
+
+task_info* scheduler::take_queued_task() {
+    // prefer rt tasks, they are the ones suffering the most from waiting
+    task_info* task = nullptr;
+    if(!rt_tasks.empty()) {
+        task = rt_tasks.smallest()->data.operator->();
+    } else if(!active_groups.empty()) {
+        task = rq(active_groups.smallest()->data.operator->()).tasks.smallest()->data.operator->();
+    }
+
+    if(task != nullptr) {
+        dequeue(task);
+    }
+    return task;
+}
+
 bool scheduler::contains_task(task_info* task) {
-    return active_tasks.find_exact(task_info_ptr(task)) != nullptr;
+    if(is_rt(task)) {
+        return rt_tasks.find_exact(rt_task_info_ptr(task)) != nullptr;
+    }
+    return rq(task->group).tasks.find_exact(task_info_ptr(task)) != nullptr;
 }
 
 }
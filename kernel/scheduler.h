@@ -4,10 +4,21 @@
 #include "wwos/avl.h"
 
 #include "process.h"
+#include "smp.h"
 
 
 namespace wwos::kernel {
 
+    // a woken task preempts the executing one only if it is ahead by more than
+    // this much physical time (in microseconds), scaled by the executing priority
+    constexpr uint64_t WAKEUP_GRANULARITY = 1000;
+
+    // real-time tasks may use at most RT_RUNTIME of every RT_PERIOD (microseconds).
+    // the rest is left to CFS tasks so that a runaway rt task cannot lock the machine.
+    constexpr uint64_t RT_PERIOD = 1000000;
+    constexpr uint64_t RT_RUNTIME = 950000;
+    constexpr uint64_t RR_TIMESLICE = 100000;
+
     class task_info_ptr {
     public:
         task_info_ptr(task_info* task): task(task) {}
@@ -19,9 +30,45 @@ namespace wwos::kernel {
         task_info* task;
     };
 
+    // orders by rt priority (highest first), then by enqueue order
+    class rt_task_info_ptr: public task_info_ptr {
+    public:
+        rt_task_info_ptr(task_info* task): task_info_ptr(task) {}
+        bool operator<(const rt_task_info_ptr& other) const;
+    };
+
+    // orders the groups queued on one cpu by their vruntime on that cpu
+    class sched_group_ptr {
+    public:
+        sched_group_ptr(sched_group* group, size_t cpu): group(group), cpu(cpu) {}
+        sched_group* operator->() {return group; }
+        bool operator<(const sched_group_ptr& other) const;
+
+    protected:
+        sched_group* group;
+        size_t cpu;
+    };
+
+    // CFS tasks are scheduled hierarchically: the scheduler picks the group with the
+    // smallest vruntime, then the task with the smallest vruntime inside that group.
+    // a group is charged physical time / weight for whatever its tasks run.
+    // every cpu has its own run queue, so the group keeps one share per cpu.
+    struct sched_group_rq {
+        uint64_t vruntime = 0;
+        avl_tree<task_info_ptr> tasks;  // runnable CFS tasks, executing task excluded
+    };
+
+    struct sched_group {
+        uint64_t id;
+        uint16_t weight = 1000;
+        size_t members = 0;     // tasks referencing this group, including blocked ones
+
+        sched_group_rq rqs[MAX_CPUS];
+    };
+
     class scheduler {
     public:
-        scheduler() {}
+        scheduler(size_t cpu): cpu(cpu) {}
         scheduler(const scheduler&) = delete;
         scheduler(scheduler&&) = delete;
         scheduler& operator=(const scheduler&) = delete;
@@ -29,20 +76,43 @@ namespace wwos::kernel {
         ~scheduler() = default;
 
         void add_task(task_info* task);
+        void wake_task(task_info* task);
         void replace_task(task_info* task_to_delete, task_info* task_to_add);
         task_info* schedule();
         void remove_task(task_info* task);
         task_info* get_executing_task();
         bool contains_task(task_info* task);
+        bool preemption_pending();
+        bool set_policy(task_info* task, sched_policy policy, uint64_t rt_priority);
 
-        
+        // number of runnable tasks waiting, the executing one excluded
+        size_t queued_count();
+        // dequeues a waiting task so that another cpu can run it, nullptr if none
+        task_info* take_queued_task();
 
     private:
+        bool should_preempt(task_info* woken);
+        bool rt_throttled(uint64_t physical_time);
+        void enqueue(task_info* task);
+        void dequeue(task_info* task);
+        void activate_group(sched_group* group);
+        void deactivate_group(sched_group* group);
+        uint64_t smallest_group_vruntime();
+        sched_group_rq& rq(sched_group* group);
+
+        size_t cpu;
+        size_t queued = 0;
         uint64_t physical_time_start = 0;
         task_info* executing_task = nullptr;
-        
-        avl_tree<task_info_ptr> active_tasks;
+        bool preempt = false;
+
+        uint64_t rt_sequence_counter = 0;
+        uint64_t rt_period_start = 0;
+        uint64_t rt_time_used = 0;
+
+        avl_tree<sched_group_ptr> active_groups;   // groups with runnable CFS tasks
+        avl_tree<rt_task_info_ptr> rt_tasks;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,159 @@
+#include "shared_memory.h"
+#include "global.h"
+#include "process.h"
+
+#include "wwos/assert.h"
+#include "wwos/defs.h"
+#include "wwos/format.h"
+#include "wwos/hash_map.h"
+#include "wwos/stdio.h"
+
+namespace wwos::kernel {
+    constexpr uint64_t PAGE_SIZE = translation_table_user::PAGE_SIZE;
+
+    hash_map<int64_t, shm_object*>* p_shm_objects;
+    int64_t shm_counter = 0;
+
+    void initialize_shared_memory() {
+        p_shm_objects = new hash_map<int64_t, shm_object*>();
+    }
+
+    static shm_object* find_by_name(string_view name) {
+        for(auto& [id, object]: p_shm_objects->items()) {
+            if(object->name.size() > 0 && string_view(object->name) == name) {
+                return object;
+            }
+        }
+        return nullptr;
+    }
+
+    // the whole range lies in the shared region and nothing is mapped there yet
+    static bool can_map(task_info& task, uint64_t va, size_t size) {
+        if(va % PAGE_SIZE != 0 || va < USERSPACE_SHARED || size > USERSPACE_SHARED_END - va) {
+            return false;
+        }
+        for(uint64_t offset = 0; offset < size; offset += PAGE_SIZE) {
+            uint64_t pa;
+            if(task.pcb.tt.translate(va + offset, pa)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void map_object(task_info& task, shm_object* object, uint64_t va) {
+        for(size_t i = 0; i < object->pages.size(); i++) {
+            task.pcb.tt.set_page(va + i * PAGE_SIZE, object->pages[i]);
+        }
+        object->mappings++;
+        task.shm_mappings.push_back({ object, va });
+    }
+
+    static void put_object(shm_object* object) {
+        wwassert(object->mappings > 0, "shared memory object not mapped");
+        object->mappings--;
+        if(object->mappings > 0) {
+            return;
+        }
+        for(auto pa: object->pages) {
+            pallocator->free(pa);
+        }
+        p_shm_objects->remove(object->id);
+        delete object;
+    }
+
+    void current_task_shm_create(const char* name, size_t size, uint64_t va) {
+        auto& task = get_current_task();
+        if(name != nullptr && find_by_name(name) != nullptr) {
+            task.pcb.set_return_value(-2);
+            return;
+        }
+        size = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+        if(size == 0 || !can_map(task, va, size)) {
+            task.pcb.set_return_value(-1);
+            return;
+        }
+
+        auto object = new shm_object { .id = shm_counter++, .name = name != nullptr ? string(name) : string() };
+        for(size_t i = 0; i < size / PAGE_SIZE; i++) {
+            auto pa = pallocator->alloc();
+            ttkernel->set_page(pa, pa);
+            object->pages.push_back(pa);
+        }
+        ttkernel->activate();
+        for(auto pa: object->pages) {
+            memset(reinterpret_cast<void*>(KA_BEGIN + pa), 0, PAGE_SIZE);
+        }
+        p_shm_objects->insert(object->id, object);
+
+        map_object(task, object, va);
+        task.pcb.tt.activate();
+        task.pcb.set_return_value(object->id);
+    }
+
+    void current_task_shm_open(const char* name) {
+        auto& task = get_current_task();
+        auto object = find_by_name(name);
+        task.pcb.set_return_value(object != nullptr ? object->id : -1);
+    }
+
+    void current_task_shm_map(int64_t id, uint64_t va) {
+        auto& task = get_current_task();
+        auto found = p_shm_objects->find(id);
+        if(found == nullptr) {
+            task.pcb.set_return_value(-1);
+            return;
+        }
+        auto object = *found;
+        if(!can_map(task, va, object->pages.size() * PAGE_SIZE)) {
+            task.pcb.set_return_value(-2);
+            return;
+        }
+
+        map_object(task, object, va);
+        task.pcb.tt.activate();
+        task.pcb.set_return_value(object->pages.size() * PAGE_SIZE);
+    }
+
+    void current_task_shm_unmap(uint64_t va) {
+        auto& task = get_current_task();
+        for(auto it = task.shm_mappings.begin(); it != task.shm_mappings.end(); ++it) {
+            auto mapping = *it;
+            if(mapping.va != va) {
+                continue;
+            }
+            for(size_t i = 0; i < mapping.object->pages.size(); i++) {
+                task.pcb.tt.unset_page(va + i * PAGE_SIZE);
+            }
+            task.pcb.tt.activate();
+            task.shm_mappings.erase(it);
+            put_object(mapping.object);
+            task.pcb.set_return_value(0);
+            return;
+        }
+        task.pcb.set_return_value(-1);
+    }
+
+    void fork_shared_memory(task_info& parent, task_info& child) {
+        for(auto& mapping: parent.shm_mappings) {
+            map_object(child, mapping.object, mapping.va);
+        }
+    }
+
+    bool is_shared_memory(task_info& task, uint64_t va) {
+        for(auto& mapping: task.shm_mappings) {
+            if(va >= mapping.va && va - mapping.va < mapping.object->pages.size() * PAGE_SIZE) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void release_shared_memory(task_info& task) {
+        // the task's tables go away with it, only the references are dropped
+        for(auto& mapping: task.shm_mappings) {
+            put_object(mapping.object);
+        }
+        task.shm_mappings.clear();
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef _WWOS_KERNEL_SHARED_MEMORY_H
+#define _WWOS_KERNEL_SHARED_MEMORY_H
+
+#include "wwos/stdint.h"
+#include "wwos/string.h"
+#include "wwos/vector.h"
+
+namespace wwos::kernel {
+    struct task_info;
+
+    // physical pages mapped into any number of tasks. freed with the last mapping
+    struct shm_object {
+        int64_t id;
+        string name;                // empty if anonymous: found by id only
+        vector<uint64_t> pages;     // physical addresses
+        size_t mappings = 0;        // across all tasks
+    };
+
+    struct shm_mapping {
+        shm_object* object;
+        uint64_t va;
+    };
+
+    void initialize_shared_memory();
+
+    // name is nullptr for an anonymous object. the creator gets it mapped at va
+    void current_task_shm_create(const char* name, size_t size, uint64_t va);
+    void current_task_shm_open(const char* name);
+    void current_task_shm_map(int64_t id, uint64_t va);
+    void current_task_shm_unmap(uint64_t va);
+
+    // a forked child shares its parent's mappings instead of copying them
+    void fork_shared_memory(task_info& parent, task_info& child);
+    bool is_shared_memory(task_info& task, uint64_t va);
+    // drops every mapping of a task that exits or execs
+    void release_shared_memory(task_info& task);
+}
+
+#endif
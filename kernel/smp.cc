@@ -0,0 +1,144 @@
+#include "wwos/assert.h"
+#include "wwos/defs.h"
+#include "wwos/format.h"
+#include "wwos/stdint.h"
+
+#include "aarch64/cpu.h"
+#include "arch.h"
+#include "global.h"
+#include "memory.h"
+#include "process.h"
+#include "scheduler.h"
+#include "smp.h"
+
+namespace wwos::kernel {
+
+spinlock g_kernel_lock;
+
+static cpu_info cpus[MAX_CPUS];
+
+cpu_info& this_cpu() {
+    return cpus[get_cpu_id()];
+}
+
+cpu_info& get_cpu(size_t id) {
+    wwassert(id < MAX_CPUS, "invalid cpu id");
+    return cpus[id];
+}
+
+size_t online_cpu_count() {
+    size_t count = 0;
+    for(size_t i = 0; i < MAX_CPUS; i++) {
+        if(cpus[i].online) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static uint64_t allocate_cpu_stack() {
+    auto stack = pallocator->alloc(KERNEL_STACK_SIZE / translation_table_kernel::PAGE_SIZE);
+    for(size_t i = 0; i < KERNEL_STACK_SIZE; i += translation_table_kernel::PAGE_SIZE) {
+        ttkernel->set_page(stack + i, stack + i);
+    }
+    ttkernel->activate();
+    return KA_BEGIN + stack + KERNEL_STACK_SIZE;
+}
+
+void initialize_smp() {
+    for(size_t i = 0; i < MAX_CPUS; i++) {
+        cpus[i].id = i;
+        cpus[i].sched = new scheduler(i);
+    }
+
+    auto& boot_cpu = this_cpu();
+    boot_cpu.online = true;
+    boot_cpu.idle_stack_top = allocate_cpu_stack();
+}
+
+static void secondary_main(uint64_t cpu_id) {
+    g_kernel_lock.lock();
+
+    setup_interrupt();
+    initialize_secondary_timer();
+    enable_user_counter_access();
+    cpus[cpu_id].online = true;
+    wwfmtlog("cpu {} online", cpu_id);
+
+    idle();
+}
+
+void start_secondary_cpus() {
+    for(size_t id = 0; id < MAX_CPUS; id++) {
+        if(cpus[id].online || !cpu_present(id)) {
+            continue;
+        }
+
+        cpus[id].idle_stack_top = allocate_cpu_stack();
+        auto ret = start_cpu(id, cpus[id].idle_stack_top, secondary_main);
+        if(ret != 0) {
+            wwfmtlog("failed to start cpu {}: {}", id, ret);
+        }
+    }
+}
+
+task_info* steal_task() {
+    auto& self = this_cpu();
+
+    cpu_info* busiest = nullptr;
+    for(size_t i = 0; i < MAX_CPUS; i++) {
+        if(!cpus[i].online || &cpus[i] == &self || cpus[i].sched->queued_count() == 0) {
+            continue;
+        }
+        if(busiest == nullptr || cpus[i].sched->queued_count() > busiest->sched->queued_count()) {
+            busiest = &cpus[i];
+        }
+    }
+
+    if(busiest == nullptr) {
+        return nullptr;
+    }
+
+    auto task = busiest->sched->take_queued_task();
+#ifdef WWOS_LOG_SCHEDULER
+    wwfmtlog("cpu {} stole task {} from cpu {}", self.id, task->pid, busiest->id);
+#endif
+    self.sched->add_task(task);
+    return self.sched->get_executing_task();
+}
+
+void kick_idle_cpu() {
+    auto& self = this_cpu();
+    for(size_t i = 0; i < MAX_CPUS; i++) {
+        if(!cpus[i].online || !cpus[i].idle || &cpus[i] == &self) {
+            continue;
+        }
+        // one cpu per queued task: the next wakeup kicks another
+        cpus[i].idle = false;
+        send_reschedule_interrupt(i);
+        return;
+    }
+}
+
+static void idle_loop() {
+    // kick_idle_cpu wakes this cpu up when work is queued elsewhere. the timer
+    // covers what is queued without a wakeup, like a preempted task
+    set_timeout_interrupt(10000);
+
+    this_cpu().idle = true;
+    g_kernel_lock.unlock();
+    wait_for_interrupt();
+    g_kernel_lock.lock();
+    this_cpu().idle = false;
+
+    acknowledge_interrupts();
+    schedule();
+}
+
+[[noreturn]] void idle() {
+    // leave the kernel stack of the task that ran last: another cpu may pick it up
+    // as soon as the lock is dropped
+    switch_stack(this_cpu().idle_stack_top, idle_loop);
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef _WWOS_KERNEL_SMP_H
+#define _WWOS_KERNEL_SMP_H
+
+#include "wwos/stdint.h"
+
+#include "aarch64/interrupt.h"
+#include "spinlock.h"
+
+namespace wwos::kernel {
+
+constexpr size_t MAX_CPUS = 8;
+
+class scheduler;
+struct task_info;
+
+struct cpu_info {
+    size_t id = 0;
+    bool online = false;
+    scheduler* sched = nullptr;
+    uint64_t idle_stack_top = 0;    // used while no task runs on this cpu
+    bool idle = false;              // waiting for an interrupt in the idle loop
+};
+
+// big kernel lock: taken on every trap entry and released right before eret.
+// it covers the schedulers, the task and semaphore tables and the filesystem.
+extern spinlock g_kernel_lock;
+
+cpu_info& this_cpu();
+cpu_info& get_cpu(size_t id);
+size_t online_cpu_count();
+
+void initialize_smp();
+void start_secondary_cpus();
+
+// moves a waiting task from the busiest run queue to this cpu and runs it.
+// returns the task now executing here, nullptr if there was nothing to steal.
+task_info* steal_task();
+
+// a task was queued on this cpu's run queue while it is busy: an idle cpu, if
+// any, is interrupted to steal it instead of waiting for its periodic check
+void kick_idle_cpu();
+
+// runs the idle loop on this cpu's own stack until a task becomes runnable
+[[noreturn]] void idle();
+
+}
+
+#endif
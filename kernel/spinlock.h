@@ -0,0 +1,42 @@
+#ifndef _WWOS_KERNEL_SPINLOCK_H
+#define _WWOS_KERNEL_SPINLOCK_H
+
+#include "wwos/stdint.h"
+
+namespace wwos::kernel {
+
+// test-and-test-and-set lock. interrupts are always masked at EL1, so a holder
+// is never preempted and the lock can be taken from the exception handler.
+class spinlock {
+public:
+    spinlock() = default;
+    spinlock(const spinlock&) = delete;
+    spinlock& operator=(const spinlock&) = delete;
+
+    void lock() {
+        while(__atomic_exchange_n(&locked, 1, __ATOMIC_ACQUIRE)) {
+            while(__atomic_load_n(&locked, __ATOMIC_RELAXED)) {
+                asm volatile("YIELD");
+            }
+        }
+    }
+
+    bool try_lock() {
+        return !__atomic_exchange_n(&locked, 1, __ATOMIC_ACQUIRE);
+    }
+
+    void unlock() {
+        __atomic_store_n(&locked, 0, __ATOMIC_RELEASE);
+    }
+
+    uint8_t* raw() {
+        return &locked;
+    }
+
+private:
+    uint8_t locked = 0;
+};
+
+}
+
+#endif
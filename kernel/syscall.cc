@@ -1,6 +1,8 @@
 #include "syscall.h"
+#include "io_ring.h"
 #include "logging.h"
 #include "process.h"
+#include "shared_memory.h"
 
 #include "wwos/assert.h"
 #include "wwos/format.h"
@@ -10,129 +12,274 @@
 #include "wwos/syscall.h"
 
 namespace wwos::kernel {
-    void receive_syscall(syscall_id id, uint64_t arg) {
-        switch (id) {
-        case syscall_id::PUTCHAR:
-            kputchar(arg);
-            break;
-        case syscall_id::GETCHAR:
-            get_current_task().pcb.set_return_value(kgetchar());
-            break;
-        case syscall_id::ALLOC:
-            kallocate_page(arg);
-            break;
-        case syscall_id::FORK:
-            fork_current_task();
-            break;
-        case syscall_id::EXEC:
-            replace_current_task(string_view(reinterpret_cast<const char*>(arg)));
-            break;
-        case syscall_id::SEMAPHORE_CREATE:
-            get_current_task().pcb.set_return_value(create_semaphore(arg));
-            break;
-        case syscall_id::SEMAPHORE_DESTROY:
-            get_current_task().pcb.set_return_value(delete_semaphore(arg));
-            break;
-        case syscall_id::SEMAPHORE_SIGNAL:
-            current_task_signal_semaphore(arg);
-            break;
-        case syscall_id::SEMAPHORE_SIGNAL_AFTER_MICROSECONDS: 
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            current_task_signal_semaphore_after_microseconds(params[0], params[1]);
-            break;    
-        }
-        case syscall_id::SEMAPHORE_WAIT:
-            current_task_wait_semaphore(arg);
-            break;
-        case syscall_id::GET_PID:
-        {
-            auto& current_task = get_current_task();
-            wwfmtlog("pid = {}\n", current_task.pid);
-            current_task.pcb.set_return_value(current_task.pid);
-            break;
+    using syscall_handler = void (*)(const uint64_t* args);
+
+    // one specialization per entry of WWOS_SYSCALLS. args are the caller's x0 - x5
+    template<syscall_id id>
+    void handle_syscall(const uint64_t* args);
+
+    template<>
+    void handle_syscall<syscall_id::PUTCHAR>(const uint64_t* args) {
+        kputchar(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::GETCHAR>(const uint64_t* args) {
+        current_task_getchar(args[0] != 0);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::CONSOLE_WRITE>(const uint64_t* args) {
+        if(args[0] >= KA_BEGIN || args[1] > KA_BEGIN - args[0]) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_OPEN:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            if(params[0] >= KA_BEGIN) {
-                get_current_task().pcb.set_return_value(-1);
-                break;
-            }
-            current_task_open(string_view(reinterpret_cast<const char*>(params[0])), static_cast<fd_mode>(params[1]));
-            break;
+        kputchars(reinterpret_cast<const char*>(args[0]), args[1]);
+        get_current_task().pcb.set_return_value(args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::ALLOC>(const uint64_t* args) {
+        kallocate_page(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FORK>(const uint64_t* args) {
+        fork_current_task();
+    }
+
+    template<>
+    void handle_syscall<syscall_id::EXEC>(const uint64_t* args) {
+        if(args[0] >= KA_BEGIN) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_CLOSE:
-            current_task_close(arg);
-            break;
-        case syscall_id::FD_CREATE:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            if(params[0] >= KA_BEGIN) {
-                get_current_task().pcb.set_return_value(-1);
-                break;
-            }
-            current_task_create(string_view(reinterpret_cast<const char*>(params[0])), static_cast<fd_type>(params[1]));
-            break;
+        replace_current_task(string_view(reinterpret_cast<const char*>(args[0])));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SPAWN>(const uint64_t* args) {
+        if(args[0] >= KA_BEGIN) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_CHILDREN:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            if(params[1] >= KA_BEGIN) {
-                get_current_task().pcb.set_return_value(-1);
-                break;
-            }
-            current_task_get_children(params[0], reinterpret_cast<char*>(params[1]), params[2]);
-            break;
+        current_task_spawn(string_view(reinterpret_cast<const char*>(args[0])), reinterpret_cast<spawn_fd_action*>(args[1]), args[2], args[3]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::EXIT>(const uint64_t* args) {
+        current_task_exit(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::WAIT>(const uint64_t* args) {
+        current_task_wait(args[0], reinterpret_cast<int64_t*>(args[1]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::GET_PID>(const uint64_t* args) {
+        auto& current_task = get_current_task();
+        current_task.pcb.set_return_value(current_task.pid);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::TASK_STAT>(const uint64_t* args) {
+        get_current_task().pcb.set_return_value((uint64_t)get_task_stat(args[0]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::TASK_USAGE>(const uint64_t* args) {
+        current_task_get_usage(args[0], reinterpret_cast<task_usage*>(args[1]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SET_PRIORITY>(const uint64_t* args) {
+        current_task_set_priority(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SET_SCHEDULER>(const uint64_t* args) {
+        current_task_set_scheduler(static_cast<sched_policy>(args[0]), args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SCHED_GROUP_CREATE>(const uint64_t* args) {
+        current_task_create_sched_group(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SEMAPHORE_CREATE>(const uint64_t* args) {
+        get_current_task().pcb.set_return_value(create_semaphore(args[0]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SEMAPHORE_SIGNAL>(const uint64_t* args) {
+        current_task_signal_semaphore(args[0], args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SEMAPHORE_SIGNAL_AFTER_MICROSECONDS>(const uint64_t* args) {
+        current_task_signal_semaphore_after_microseconds(args[0], args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SEMAPHORE_WAIT>(const uint64_t* args) {
+        current_task_wait_semaphore(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SEMAPHORE_DESTROY>(const uint64_t* args) {
+        get_current_task().pcb.set_return_value(delete_semaphore(args[0]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::MQ_CREATE>(const uint64_t* args) {
+        get_current_task().pcb.set_return_value(create_message_queue(args[0], args[1]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::MQ_DESTROY>(const uint64_t* args) {
+        get_current_task().pcb.set_return_value(delete_message_queue(args[0]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::MQ_SEND>(const uint64_t* args) {
+        current_task_send_message(args[0], reinterpret_cast<uint8_t*>(args[1]), args[2], args[3], args[4]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::MQ_RECEIVE>(const uint64_t* args) {
+        current_task_receive_message(args[0], reinterpret_cast<uint8_t*>(args[1]), args[2], reinterpret_cast<uint64_t*>(args[3]), args[4]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SHM_CREATE>(const uint64_t* args) {
+        if(args[0] >= KA_BEGIN) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_READ:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            if(params[1] >= KA_BEGIN) {
-                get_current_task().pcb.set_return_value(-1);
-                break;
-            }
-            current_task_read(params[0], reinterpret_cast<uint8_t*>(params[1]), params[2]);
-            break;
+        current_task_shm_create(reinterpret_cast<const char*>(args[0]), args[1], args[2]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SHM_OPEN>(const uint64_t* args) {
+        if(args[0] == 0 || args[0] >= KA_BEGIN) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_WRITE:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            if(params[1] >= KA_BEGIN) {
-                get_current_task().pcb.set_return_value(-1);
-                break;
-            }
-            current_task_write(params[0], reinterpret_cast<uint8_t*>(params[1]), params[2]);
-            break;
+        current_task_shm_open(reinterpret_cast<const char*>(args[0]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SHM_MAP>(const uint64_t* args) {
+        current_task_shm_map(args[0], args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::SHM_UNMAP>(const uint64_t* args) {
+        current_task_shm_unmap(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::WAIT_ON_ADDRESS>(const uint64_t* args) {
+        current_task_wait_on_address(reinterpret_cast<uint32_t*>(args[0]), args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::WAKE_ADDRESS>(const uint64_t* args) {
+        current_task_wake_address(reinterpret_cast<uint32_t*>(args[0]), args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_OPEN>(const uint64_t* args) {
+        if(args[0] >= KA_BEGIN) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_SEEK:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            current_task_seek(params[0], params[1]);
-            break;
+        current_task_open(string_view(reinterpret_cast<const char*>(args[0])), static_cast<fd_mode>(args[1]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_CLOSE>(const uint64_t* args) {
+        current_task_close(args[0]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_CREATE>(const uint64_t* args) {
+        if(args[0] >= KA_BEGIN) {
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
-        case syscall_id::FD_STAT:
-        {
-            uint64_t* params = reinterpret_cast<uint64_t*>(arg);
-            if(params[1] >= KA_BEGIN) {
-                get_current_task().pcb.set_return_value(-1);
-                break;
-            }
-            current_task_stat(params[0], reinterpret_cast<fd_stat*>(params[1]));
-            break;
+        current_task_create(string_view(reinterpret_cast<const char*>(args[0])), static_cast<fd_type>(args[1]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_CHILDREN>(const uint64_t* args) {
+        current_task_get_children(args[0], reinterpret_cast<char*>(args[1]), args[2]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_READ>(const uint64_t* args) {
+        current_task_read(args[0], reinterpret_cast<uint8_t*>(args[1]), args[2]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_WRITE>(const uint64_t* args) {
+        current_task_write(args[0], reinterpret_cast<uint8_t*>(args[1]), args[2]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_SEEK>(const uint64_t* args) {
+        current_task_seek(args[0], args[1]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_STAT>(const uint64_t* args) {
+        current_task_stat(args[0], reinterpret_cast<fd_stat*>(args[1]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::FD_CONTROL>(const uint64_t* args) {
+        current_task_control(args[0], static_cast<fd_control>(args[1]), args[2]);
+    }
+
+    template<>
+    void handle_syscall<syscall_id::POLL>(const uint64_t* args) {
+        current_task_poll(reinterpret_cast<poll_fd*>(args[0]), args[1], static_cast<int64_t>(args[2]));
+    }
+
+    template<>
+    void handle_syscall<syscall_id::IO_RING_SETUP>(const uint64_t* args) {
+        current_task_setup_io_ring();
+    }
+
+    template<>
+    void handle_syscall<syscall_id::IO_RING_ENTER>(const uint64_t* args) {
+        current_task_enter_io_ring(args[0]);
+    }
+
+    constexpr syscall_handler syscall_table[] = {
+#define WWOS_SYSCALL_HANDLER(name) &handle_syscall<syscall_id::name>,
+        WWOS_SYSCALLS(WWOS_SYSCALL_HANDLER)
+#undef WWOS_SYSCALL_HANDLER
+    };
+
+    static_assert(sizeof(syscall_table) / sizeof(syscall_table[0]) == static_cast<size_t>(syscall_id::COUNT));
+
+    void receive_syscall(const trap_frame& frame) {
+        // copied: the return value overwrites x0, and exec replaces the task
+        uint64_t args[6];
+        for(size_t i = 0; i < 6; i++) {
+            args[i] = frame.registers[i];
         }
-        case wwos::syscall_id::TASK_STAT:
-            get_current_task().pcb.set_return_value((uint64_t)get_task_stat(arg));
-            break;
-        case wwos::syscall_id::SET_PRIORITY:
-            current_task_set_priority(arg);
-            break;
-        case syscall_id::EXIT:
-            current_task_exit();
-            break;
-        default:
-            wwassert(false, "Unknown syscall id");
-            break;
+
+        auto id = frame.registers[8];
+        if(id >= static_cast<uint64_t>(syscall_id::COUNT)) {
+            wwfmtlog("unknown syscall {}", id);
+            get_current_task().pcb.set_return_value(-1);
+            return;
         }
+
+        syscall_table[id](args);
     }
-}
\ No newline at end of file
+}
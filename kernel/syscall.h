@@ -3,8 +3,11 @@
 
 
 #include "wwos/syscall.h"
+#include "aarch64/interrupt.h"
+
 namespace wwos::kernel {
-    void receive_syscall(syscall_id id, uint64_t arg);
+    // dispatches on the number in x8 of the trapped task's saved registers
+    void receive_syscall(const trap_frame& frame);
 }
 
 
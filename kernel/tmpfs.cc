@@ -0,0 +1,214 @@
+#include "tmpfs.h"
+#include "global.h"
+#include "memory.h"
+#include "vfs.h"
+
+#include "wwos/algorithm.h"
+#include "wwos/alloc.h"
+#include "wwos/assert.h"
+#include "wwos/hash_map.h"
+
+namespace wwos::kernel {
+    constexpr uint64_t PAGE_SIZE = translation_table_kernel::PAGE_SIZE;
+    // a table of the radix tree is one page of physical addresses
+    constexpr size_t SLOT_BITS = 9;
+    constexpr size_t SLOTS = 1 << SLOT_BITS;
+    static_assert(SLOTS * sizeof(uint64_t) == PAGE_SIZE);
+
+    struct tmpfs_node {
+        fd_type type;
+
+        // files: the data pages, under height levels of tables. height 0 means
+        // root is the only data page. a missing page (0) reads as zeros
+        size_t size = 0;
+        uint64_t root = 0;
+        size_t height = 0;
+
+        // directories
+        hash_map<string, int64_t> children;
+    };
+
+    // a node's id is its index
+    struct tmpfs {
+        vector<tmpfs_node*> nodes;
+    };
+
+    static tmpfs_node* get_node(mount* mnt, int64_t id) {
+        return static_cast<tmpfs*>(mnt->data)->nodes[id];
+    }
+
+    static uint64_t* table_of(uint64_t pa) {
+        return reinterpret_cast<uint64_t*>(KA_BEGIN + pa);
+    }
+
+    // 0 if physical memory ran out
+    static uint64_t allocate_zeroed_page() {
+        auto pa = pallocator->alloc();
+        if(pa == 0) {
+            return 0;
+        }
+        ttkernel->set_page(pa, pa);
+        ttkernel->activate();
+        memset(reinterpret_cast<void*>(KA_BEGIN + pa), 0, PAGE_SIZE);
+        return pa;
+    }
+
+    static void free_tree(uint64_t pa, size_t height) {
+        if(height > 0) {
+            auto table = table_of(pa);
+            for(size_t i = 0; i < SLOTS; i++) {
+                if(table[i] != 0) {
+                    free_tree(table[i], height - 1);
+                }
+            }
+        }
+        pallocator->free(pa);
+    }
+
+    // the data page holding page index of the file. with allocate, missing
+    // tables and pages are created on the way, otherwise 0 is returned for them
+    static uint64_t find_page(tmpfs_node* file, size_t index, bool allocate) {
+        while(index >= (size_t(1) << (SLOT_BITS * file->height))) {
+            if(!allocate) {
+                return 0;
+            }
+            // one more level on top, the old tree becomes its first slot
+            if(file->root != 0) {
+                auto table = allocate_zeroed_page();
+                if(table == 0) {
+                    return 0;
+                }
+                table_of(table)[0] = file->root;
+                file->root = table;
+            }
+            file->height++;
+        }
+
+        if(file->root == 0) {
+            if(!allocate || (file->root = allocate_zeroed_page()) == 0) {
+                return 0;
+            }
+        }
+
+        auto pa = file->root;
+        for(size_t level = file->height; level > 0; level--) {
+            auto& slot = table_of(pa)[(index >> (SLOT_BITS * (level - 1))) & (SLOTS - 1)];
+            if(slot == 0) {
+                if(!allocate || (slot = allocate_zeroed_page()) == 0) {
+                    return 0;
+                }
+            }
+            pa = slot;
+        }
+        return pa;
+    }
+
+    static int64_t tmpfs_get_root(mount* mnt) {
+        return 0;
+    }
+
+    static int64_t tmpfs_lookup(mount* mnt, int64_t dir, string_view name) {
+        auto id = get_node(mnt, dir)->children.find(string(name.data(), name.size()));
+        return id != nullptr ? *id : -1;
+    }
+
+    static int64_t tmpfs_create(mount* mnt, int64_t dir, string_view name, fd_type type) {
+        auto parent = get_node(mnt, dir);
+        auto key = string(name.data(), name.size());
+        if(parent->children.contains(key)) {
+            return -1;
+        }
+
+        auto& nodes = static_cast<tmpfs*>(mnt->data)->nodes;
+        int64_t id = nodes.size();
+        nodes.push_back(new tmpfs_node { .type = type });
+        parent->children.insert(key, id);
+        return id;
+    }
+
+    static fd_type tmpfs_get_type(mount* mnt, int64_t id) {
+        return get_node(mnt, id)->type;
+    }
+
+    static size_t tmpfs_get_size(mount* mnt, int64_t id) {
+        return get_node(mnt, id)->size;
+    }
+
+    static vector<string> tmpfs_get_children(mount* mnt, int64_t dir) {
+        vector<string> names;
+        for(auto& [name, id]: get_node(mnt, dir)->children.items()) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    static size_t tmpfs_read(mount* mnt, int64_t id, size_t offset, size_t size, void* buffer) {
+        auto file = get_node(mnt, id);
+        if(offset >= file->size) {
+            return 0;
+        }
+        size = min<size_t>(size, file->size - offset);
+
+        auto out = static_cast<uint8_t*>(buffer);
+        for(size_t done = 0; done < size;) {
+            auto in_page = (offset + done) % PAGE_SIZE;
+            auto n = min<size_t>(size - done, PAGE_SIZE - in_page);
+            auto pa = find_page(file, (offset + done) / PAGE_SIZE, false);
+            if(pa == 0) {
+                memset(out + done, 0, n);
+            } else {
+                memcpy(out + done, reinterpret_cast<uint8_t*>(KA_BEGIN + pa) + in_page, n);
+            }
+            done += n;
+        }
+        return size;
+    }
+
+    // short if physical memory runs out
+    static size_t tmpfs_write(mount* mnt, int64_t id, size_t offset, size_t size, const void* buffer) {
+        auto file = get_node(mnt, id);
+        auto in = static_cast<const uint8_t*>(buffer);
+        size_t done = 0;
+        while(done < size) {
+            auto in_page = (offset + done) % PAGE_SIZE;
+            auto n = min<size_t>(size - done, PAGE_SIZE - in_page);
+            auto pa = find_page(file, (offset + done) / PAGE_SIZE, true);
+            if(pa == 0) {
+                break;
+            }
+            memcpy(reinterpret_cast<uint8_t*>(KA_BEGIN + pa) + in_page, in + done, n);
+            done += n;
+        }
+        file->size = max<size_t>(file->size, offset + done);
+        return done;
+    }
+
+    static void tmpfs_truncate(mount* mnt, int64_t id) {
+        auto file = get_node(mnt, id);
+        if(file->root != 0) {
+            free_tree(file->root, file->height);
+        }
+        file->size = 0;
+        file->root = 0;
+        file->height = 0;
+    }
+
+    constexpr vfs_operations tmpfs_operations = {
+        .get_root = tmpfs_get_root,
+        .lookup = tmpfs_lookup,
+        .create = tmpfs_create,
+        .get_type = tmpfs_get_type,
+        .get_size = tmpfs_get_size,
+        .get_children = tmpfs_get_children,
+        .read = tmpfs_read,
+        .write = tmpfs_write,
+        .truncate = tmpfs_truncate,
+        .cache_lookups = true,
+    };
+
+    void mount_tmpfs(string_view path) {
+        auto fs = new tmpfs();
+        fs->nodes.push_back(new tmpfs_node { .type = fd_type::DIRECTORY });
+        mount_file_system(path, &tmpfs_operations, fs);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef _WWOS_KERNEL_TMPFS_H
+#define _WWOS_KERNEL_TMPFS_H
+
+#include "wwos/string_view.h"
+
+namespace wwos::kernel {
+    // files kept in physical pages reached through a radix tree, directories
+    // in hash tables. nothing survives a reboot
+    void mount_tmpfs(string_view path);
+}
+
+#endif
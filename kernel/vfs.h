@@ -0,0 +1,56 @@
+#ifndef _WWOS_KERNEL_VFS_H
+#define _WWOS_KERNEL_VFS_H
+
+#include "wwos/hash_map.h"
+#include "wwos/stdint.h"
+#include "wwos/string.h"
+#include "wwos/string_view.h"
+#include "wwos/syscall.h"
+#include "wwos/vector.h"
+
+namespace wwos::kernel {
+
+struct mount;
+struct shared_file_node;
+
+// a file system driver. ids are the driver's own node numbers, stable for as
+// long as the node exists. FIFO contents never reach the driver: the vfs keeps
+// them in memory
+struct vfs_operations {
+    int64_t (*get_root)(mount* mnt);
+    // -1 if dir has no child called name
+    int64_t (*lookup)(mount* mnt, int64_t dir, string_view name);
+    // -1 if name exists, or the driver does not support type in dir
+    int64_t (*create)(mount* mnt, int64_t dir, string_view name, fd_type type);
+    fd_type (*get_type)(mount* mnt, int64_t id);
+    size_t (*get_size)(mount* mnt, int64_t id);
+    vector<string> (*get_children)(mount* mnt, int64_t dir);
+    size_t (*read)(mount* mnt, int64_t id, size_t offset, size_t size, void* buffer);
+    // files only. nullptr if they are read only: opening one for writing fails
+    size_t (*write)(mount* mnt, int64_t id, size_t offset, size_t size, const void* buffer);
+    // a file opened for writing starts empty
+    void (*truncate)(mount* mnt, int64_t id);
+    // lookups may be remembered, also those that found nothing, until create
+    // adds the name. not for drivers whose names come and go on their own
+    bool cache_lookups;
+};
+
+struct mount {
+    string path;                    // without trailing slash, "/" for the root
+    const vfs_operations* ops;
+    void* data;                     // the driver's
+    // vnode cache: nodes open somewhere, and FIFOs still holding data
+    hash_map<int64_t, shared_file_node*> vnodes;
+};
+
+// path need not exist in the file system it is mounted over, it is listed in
+// its parent directory either way
+mount* mount_file_system(string_view path, const vfs_operations* ops, void* data);
+
+// id no longer exists in mnt: its vnode leaves the cache, and is freed once the
+// last opener closed it, whatever a FIFO still buffers
+void vfs_unlink(mount* mnt, int64_t id);
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _WWOS_KERNEL_WAIT_QUEUE_H
+#define _WWOS_KERNEL_WAIT_QUEUE_H
+
+#include "wwos/assert.h"
+#include "wwos/stdint.h"
+#include "wwos/vector.h"
+
+namespace wwos::kernel {
+
+struct task_info;
+struct task_queue;
+
+// tasks blocked until some event happens on the object owning the queue.
+// see wait_on / wake_up in process.h
+struct wait_queue {
+    vector<int64_t> waiting_tasks;  // pids, in arrival order
+};
+
+// embedded in task_info: a task sleeps on at most one task_queue, so linking it
+// never allocates and unlinking it needs no search
+struct wait_link {
+    wait_link* prev = nullptr;
+    wait_link* next = nullptr;
+    task_queue* queue = nullptr;    // nullptr while not linked
+    task_info* task = nullptr;
+};
+
+// FIFO of tasks sleeping on a semaphore or a futex word. unlike wait_queue the
+// sleep is not restarted: the waker hands the task its result.
+// see wake_n / wake_all in process.h
+struct task_queue {
+    task_queue() {
+        head.prev = &head;
+        head.next = &head;
+    }
+    task_queue(const task_queue&) = delete;
+    task_queue& operator=(const task_queue&) = delete;
+
+    void push_back(wait_link& link) {
+        wwassert(link.queue == nullptr, "task already sleeps on a queue");
+        link.prev = head.prev;
+        link.next = &head;
+        head.prev->next = &link;
+        head.prev = &link;
+        link.queue = this;
+        m_size++;
+    }
+
+    // nullptr if empty
+    task_info* pop_front() {
+        if(empty()) {
+            return nullptr;
+        }
+        auto link = head.next;
+        remove(*link);
+        return link->task;
+    }
+
+    // takes a task off whichever queue it sleeps on, e.g. on a timeout
+    static void remove(wait_link& link) {
+        wwassert(link.queue != nullptr, "task does not sleep on a queue");
+        link.prev->next = link.next;
+        link.next->prev = link.prev;
+        link.queue->m_size--;
+        link.prev = link.next = nullptr;
+        link.queue = nullptr;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+private:
+    wait_link head;     // sentinel
+    size_t m_size = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "wwfs_driver.h"
+#include "vfs.h"
+
+#include "wwos/alloc.h"
+#include "wwos/assert.h"
+#include "wwos/wwfs.h"
+
+namespace wwos::kernel {
+    static wwfs::basic_file_system* get_fs(mount* mnt) {
+        return static_cast<wwfs::basic_file_system*>(mnt->data);
+    }
+
+    static int64_t wwfs_get_root(mount* mnt) {
+        return get_fs(mnt)->get_root();
+    }
+
+    static int64_t wwfs_lookup(mount* mnt, int64_t dir, string_view name) {
+        for(auto& [child_name, child_id]: get_fs(mnt)->get_children(dir)) {
+            if(string_view(child_name) == name) {
+                return child_id;
+            }
+        }
+        return -1;
+    }
+
+    static int64_t wwfs_create(mount* mnt, int64_t dir, string_view name, fd_type type) {
+        if(wwfs_lookup(mnt, dir, name) >= 0) {
+            return -1;
+        }
+
+        wwfs::inode_type itype;
+        if(type == fd_type::DIRECTORY) {
+            itype = wwfs::inode_type::DIRECTORY;
+        } else if(type == fd_type::FILE) {
+            itype = wwfs::inode_type::FILE;
+        } else {
+            itype = wwfs::inode_type::FIFO;
+        }
+        return get_fs(mnt)->create(dir, name, itype);
+    }
+
+    static fd_type wwfs_get_type(mount* mnt, int64_t id) {
+        auto itype = get_fs(mnt)->get_inode_type(id);
+        if(itype == wwfs::inode_type::DIRECTORY) {
+            return fd_type::DIRECTORY;
+        } else if(itype == wwfs::inode_type::FILE) {
+            return fd_type::FILE;
+        }
+        return fd_type::FIFO;
+    }
+
+    static size_t wwfs_get_size(mount* mnt, int64_t id) {
+        return get_fs(mnt)->get_inode_size(id);
+    }
+
+    static vector<string> wwfs_get_children(mount* mnt, int64_t dir) {
+        vector<string> names;
+        for(auto& [name, id]: get_fs(mnt)->get_children(dir)) {
+            names.push_back(name);
+        }
+        return names;
+    }
+
+    static size_t wwfs_read(mount* mnt, int64_t id, size_t offset, size_t size, void* buffer) {
+        return get_fs(mnt)->read_data(id, offset, size, buffer);
+    }
+
+    static size_t wwfs_write(mount* mnt, int64_t id, size_t offset, size_t size, const void* buffer) {
+        return get_fs(mnt)->write_data(id, offset, size, buffer);
+    }
+
+    static void wwfs_truncate(mount* mnt, int64_t id) {
+        get_fs(mnt)->resize_inode(id, 0);
+    }
+
+    constexpr vfs_operations wwfs_operations = {
+        .get_root = wwfs_get_root,
+        .lookup = wwfs_lookup,
+        .create = wwfs_create,
+        .get_type = wwfs_get_type,
+        .get_size = wwfs_get_size,
+        .get_children = wwfs_get_children,
+        .read = wwfs_read,
+        .write = wwfs_write,
+        .truncate = wwfs_truncate,
+        .cache_lookups = true,
+    };
+
+    void mount_wwfs(string_view path, void* addr, size_t size) {
+        wwassert(size >= sizeof(wwfs::meta_t), "Invalid size");
+
+        wwfs::meta_t meta;
+        memcpy(&meta, addr, sizeof(wwfs::meta_t));
+        auto hw_memory = new wwfs::file_system_hardware_memory(addr, meta.block_size, meta.required_size() / meta.block_size);
+
+        auto fs = new wwfs::basic_file_system(hw_memory);
+        fs->initialize();
+
+        mount_file_system(path, &wwfs_operations, fs);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef _WWOS_KERNEL_WWFS_DRIVER_H
+#define _WWOS_KERNEL_WWFS_DRIVER_H
+
+#include "wwos/stdint.h"
+#include "wwos/string_view.h"
+
+namespace wwos::kernel {
+    // the wwfs image the kernel is booted with, at addr, mounted on path
+    void mount_wwfs(string_view path, void* addr, size_t size);
+}
+
+#endif
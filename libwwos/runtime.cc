@@ -61,16 +61,16 @@ extern "C" void _wwos_runtime_entry(int* argc, char*** argv) {
     
     auto pid = wwos::get_pid();
 
-    fd_stdin = wwos::open(wwos::format("/proc/{}/fifo/stdin", pid), wwos::fd_mode::READONLY);
-    fd_stdout = wwos::open(wwos::format("/proc/{}/fifo/stdout", pid), wwos::fd_mode::WRITEONLY);
+    // a spawned task may have been handed its stdin / stdout already
+    wwos::fd_stat s;
+    fd_stdin = wwos::stat(0, &s) == 0 ? 0 : wwos::open(wwos::format("/proc/{}/fifo/stdin", pid), wwos::fd_mode::READONLY);
+    fd_stdout = wwos::stat(1, &s) == 0 ? 1 : wwos::open(wwos::format("/proc/{}/fifo/stdout", pid), wwos::fd_mode::WRITEONLY);
 
     if(fd_stdin < 0 || fd_stdout < 0) {
         wwlog("Failed to open stdin/stdout");
     }
-    wwassert(fd_stdin == 0 && fd_stdout == 1, "Invalid file descriptor");
     
-    main();
-    exit();
+    exit(main());
 }
 
 void* operator new(wwos::size_t size) {
@@ -0,0 +1,86 @@
+#include "wwos/sync.h"
+#include "wwos/syscall.h"
+
+namespace wwos {
+
+    static uint32_t compare_and_swap(uint32_t* word, uint32_t expected, uint32_t desired) {
+        __atomic_compare_exchange_n(word, &expected, desired, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+        return expected;
+    }
+
+    void mutex::lock() {
+        auto c = compare_and_swap(&state, 0, 1);
+        if(c == 0) {
+            return;
+        }
+        // contended: mark the lock as having sleepers before sleeping, so that
+        // the holder knows to wake someone up
+        do {
+            if(c == 2 || compare_and_swap(&state, 1, 2) != 0) {
+                wait_on_address(&state, 2);
+            }
+        } while((c = compare_and_swap(&state, 0, 2)) != 0);
+    }
+
+    bool mutex::try_lock() {
+        return compare_and_swap(&state, 0, 1) == 0;
+    }
+
+    void mutex::unlock() {
+        if(__atomic_fetch_sub(&state, 1, __ATOMIC_RELEASE) != 1) {
+            __atomic_store_n(&state, 0, __ATOMIC_RELEASE);
+            wake_address(&state, 1);
+        }
+    }
+
+    bool semaphore::try_wait() {
+        auto c = __atomic_load_n(&count, __ATOMIC_RELAXED);
+        while(c > 0) {
+            if(__atomic_compare_exchange_n(&count, &c, c - 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void semaphore::wait() {
+        while(!try_wait()) {
+            // a signal between try_wait and the sleep either sees the sleeper,
+            // or makes the kernel's check of count fail
+            __atomic_fetch_add(&sleepers, 1, __ATOMIC_SEQ_CST);
+            wait_on_address(&count, 0);
+            __atomic_fetch_sub(&sleepers, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    void semaphore::signal() {
+        __atomic_fetch_add(&count, 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+            wake_address(&count, 1);
+        }
+    }
+
+    void condition_variable::wait(mutex& m) {
+        auto seen = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&sleepers, 1, __ATOMIC_SEQ_CST);
+        m.unlock();
+        // returns at once if a notify came in since seen was read
+        wait_on_address(&sequence, seen);
+        __atomic_fetch_sub(&sleepers, 1, __ATOMIC_RELAXED);
+        m.lock();
+    }
+
+    void condition_variable::notify_one() {
+        __atomic_fetch_add(&sequence, 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+            wake_address(&sequence, 1);
+        }
+    }
+
+    void condition_variable::notify_all() {
+        __atomic_fetch_add(&sequence, 1, __ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST) > 0) {
+            wake_address(&sequence, ~0ull);
+        }
+    }
+}
@@ -18,8 +18,7 @@ namespace wwos {
 
     int64_t get_children(int64_t fd, vector<string>& out) {
         vector<uint8_t> buffer(4096);
-        uint64_t params[] = {static_cast<uint64_t>(fd), reinterpret_cast<uint64_t>(buffer.data()), buffer.size()};
-        int64_t ret = syscall(syscall_id::FD_CHILDREN, reinterpret_cast<uint64_t>(params));
+        int64_t ret = syscall(syscall_id::FD_CHILDREN, fd, reinterpret_cast<uint64_t>(buffer.data()), buffer.size());
 
         if(ret < 0) {
             return ret;
@@ -32,9 +31,7 @@ namespace wwos {
             wwassert(counter < 1000, "Too many retries");
 
             buffer = vector<uint8_t>(ret);
-            params[1] = reinterpret_cast<uint64_t>(buffer.data());
-            params[2] = ret;
-            ret = syscall(syscall_id::FD_CHILDREN, reinterpret_cast<uint64_t>(params));
+            ret = syscall(syscall_id::FD_CHILDREN, fd, reinterpret_cast<uint64_t>(buffer.data()), ret);
             if(ret < 0) {
                 return ret;
             }
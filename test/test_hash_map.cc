@@ -0,0 +1,110 @@
+#include "wwos/assert.h"
+#include "wwos/hash_map.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <string>
+
+
+int main() {
+    srand(time(nullptr));
+
+    int N = 10;
+
+    while(N < 1000000) {
+        wwos::hash_map<uint64_t, uint64_t> m;
+        std::map<uint64_t, uint64_t> reference;
+
+        auto time_begin = std::chrono::high_resolution_clock::now();
+
+        for(int i = 0; i < N; i++) {
+            uint64_t key = rand() % (N * 2);
+            if(reference.count(key)) {
+                m.update(key, i);
+            } else {
+                auto& stored = m.insert(key, i);
+                wwassert(&stored == m.find(key) && stored == i, "insert returned the wrong value");
+            }
+            reference[key] = i;
+        }
+        wwassert(m.size() == reference.size(), "wrong size after insert");
+
+        for(int i = 0; i < N * 2; i++) {
+            auto value = m.find(i);
+            if(reference.count(i)) {
+                wwassert(value != nullptr && *value == reference[i], "wrong value");
+            } else {
+                wwassert(value == nullptr, "found a missing key");
+            }
+        }
+
+        auto copy = m;
+        wwassert(copy.size() == m.size(), "wrong size after copy");
+
+        for(int i = 0; i < N; i += 2) {
+            if(reference.count(i)) {
+                m.remove(i);
+                reference.erase(i);
+            }
+        }
+        wwassert(m.size() == reference.size(), "wrong size after remove");
+
+        for(auto& item: m.items()) {
+            wwassert(reference.count(item.first) && reference[item.first] == item.second, "wrong item");
+        }
+        for(auto& [key, value]: reference) {
+            wwassert(copy.get(key) == value, "copy changed with the original");
+        }
+
+        m.clear();
+        wwassert(m.empty() && m.find(0) == nullptr, "not empty after clear");
+
+        auto time_end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_begin);
+
+        std::cout << "N = " << N << ", duration = " << duration.count() * 1.0 / 1000000 << " s" << std::endl;
+
+        N *= 10;
+    }
+
+    wwos::hash_map<wwos::string, int> names;
+    for(int i = 0; i < 10000; i++) {
+        names.insert(wwos::string(std::to_string(i).c_str()), i);
+    }
+    for(int i = 0; i < 10000; i++) {
+        auto value = names.find(wwos::string(std::to_string(i).c_str()));
+        wwassert(value != nullptr && *value == i, "wrong value for a string key");
+    }
+    wwassert(names.find(wwos::string("10000")) == nullptr, "found a missing string key");
+
+    // a key found through a cheaper stand-in for it
+    struct point {
+        int x, y;
+        bool operator==(const point& other) const { return x == other.x && y == other.y; }
+        bool operator==(int packed) const { return x * 1000 + y == packed; }
+    };
+    struct point_hash {
+        uint64_t operator()(const point& p) const { return wwos::hash_integer(p.x * 1000 + p.y); }
+        uint64_t operator()(int packed) const { return wwos::hash_integer(packed); }
+    };
+    wwos::hash_map<point, int, point_hash> points;
+    for(int x = 0; x < 100; x++) {
+        for(int y = 0; y < 100; y++) {
+            points.insert({x, y}, x + y);
+        }
+    }
+    for(int packed = 0; packed < 100000; packed += 7) {
+        auto value = points.find_as(packed);
+        if(packed / 1000 < 100 && packed % 1000 < 100) {
+            wwassert(value != nullptr && *value == packed / 1000 + packed % 1000, "wrong value found as");
+        } else {
+            wwassert(value == nullptr, "found as a missing key");
+        }
+    }
+
+
+    std::cout << "test passed" << std::endl;
+}
@@ -0,0 +1,95 @@
+#include "wwos/assert.h"
+#include "wwos/queue.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+
+// bytes moved by one push or pop at most: a few segments, so that every round
+// stays linear in N
+constexpr size_t MAX_BATCH = 4 * 64;
+
+// hands out a fixed number of segments, like the kernel running out of pages
+struct limited_allocator {
+    static inline size_t left = 0;
+
+    static void* allocate() {
+        if(left == 0) {
+            return nullptr;
+        }
+        left--;
+        return new uint8_t[64];
+    }
+
+    static void free(void* segment) {
+        left++;
+        delete[] static_cast<uint8_t*>(segment);
+    }
+};
+
+int main() {
+    srand(time(nullptr));
+
+    int N = 10;
+
+    while(N < 1000000) {
+        size_t capacity = 1 + rand() % (N * 4);
+        wwos::segmented_queue<uint8_t, 64> q(capacity);
+        std::deque<uint8_t> reference;
+        std::vector<uint8_t> buffer(MAX_BATCH);
+
+        auto time_begin = std::chrono::high_resolution_clock::now();
+
+        for(int i = 0; i < N; i++) {
+            size_t count = rand() % (std::min<size_t>(N / 10, MAX_BATCH) + 1);
+            if(rand() % 2) {
+                for(size_t j = 0; j < count; j++) {
+                    buffer[j] = rand();
+                }
+                auto pushed = q.push(buffer.data(), count);
+                wwassert(pushed == std::min(count, capacity - reference.size()), "wrong push size");
+                reference.insert(reference.end(), buffer.begin(), buffer.begin() + pushed);
+            } else {
+                auto popped = q.pop(buffer.data(), count);
+                wwassert(popped == std::min(count, reference.size()), "wrong pop size");
+                for(size_t j = 0; j < popped; j++) {
+                    wwassert(buffer[j] == reference.front(), "wrong element");
+                    reference.pop_front();
+                }
+            }
+            wwassert(q.size() == reference.size(), "wrong size");
+            wwassert(q.segments() <= (q.size() + 55) / 56 + 1, "drained segments kept");
+        }
+
+        q.set_capacity(q.size() / 2);
+        wwassert(q.space() == 0 && q.push(buffer.data(), 1) == 0, "pushed over capacity");
+
+        while(q.size() > 0) {
+            q.pop(buffer.data(), 1);
+        }
+        wwassert(q.segments() == 0, "empty queue holds segments");
+
+        auto time_end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_begin);
+
+        std::cout << "N = " << N << ", duration = " << duration.count() * 1.0 / 1000000 << " s" << std::endl;
+
+        N *= 10;
+    }
+
+    {
+        limited_allocator::left = 2;
+        wwos::segmented_queue<uint8_t, 64, limited_allocator> q(1000);
+        std::vector<uint8_t> buffer(1000);
+        auto pushed = q.push(buffer.data(), buffer.size());
+        wwassert(pushed == q.size() && q.segments() == 2 && pushed < buffer.size(), "pushed without memory");
+        wwassert(q.push(buffer.data(), 1) == 0, "pushed without memory");
+        wwassert(q.pop(buffer.data(), buffer.size()) == pushed && limited_allocator::left == 2, "segments not returned");
+    }
+
+    std::cout << "test passed" << std::endl;
+}
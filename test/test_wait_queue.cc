@@ -0,0 +1,73 @@
+#include "wwos/assert.h"
+
+#include "../kernel/wait_queue.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <list>
+#include <vector>
+
+namespace wwos::kernel {
+    struct task_info {
+        wait_link sleep_link;
+    };
+}
+
+using wwos::kernel::task_info;
+using wwos::kernel::task_queue;
+
+
+int main() {
+    srand(time(nullptr));
+
+    int N = 10;
+
+    while(N < 1000000) {
+        std::vector<task_info> tasks(N);
+        task_queue queue;
+        std::list<task_info*> reference;
+        std::vector<std::list<task_info*>::iterator> position(N);
+
+        auto time_begin = std::chrono::high_resolution_clock::now();
+
+        for(int i = 0; i < N; i++) {
+            auto index = rand() % N;
+            auto task = &tasks[index];
+            auto& link = task->sleep_link;
+            auto choice = rand() % 3;
+            if(link.queue == nullptr) {
+                link.task = task;
+                queue.push_back(link);
+                position[index] = reference.insert(reference.end(), task);
+            } else if(choice == 0) {
+                // taken off from wherever it is, like a task torn down in its sleep
+                task_queue::remove(link);
+                reference.erase(position[index]);
+                wwassert(link.queue == nullptr, "still linked after remove");
+            } else if(choice == 1) {
+                auto front = queue.pop_front();
+                wwassert(front == reference.front(), "wrong order");
+                reference.pop_front();
+                wwassert(front->sleep_link.queue == nullptr, "still linked after pop");
+            }
+            wwassert(queue.size() == reference.size(), "wrong size");
+        }
+
+        while(!reference.empty()) {
+            wwassert(queue.pop_front() == reference.front(), "wrong order");
+            reference.pop_front();
+        }
+        wwassert(queue.empty() && queue.pop_front() == nullptr, "not empty");
+
+        auto time_end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(time_end - time_begin);
+
+        std::cout << "N = " << N << ", duration = " << duration.count() * 1.0 / 1000000 << " s" << std::endl;
+
+        N *= 10;
+    }
+
+    std::cout << "test passed" << std::endl;
+}
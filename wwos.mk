@@ -3,6 +3,7 @@ BOARD = aarch64-virt9
 SIZE_PREKERNEL = 0x2000000 # 32 MB
 
 CPU = cortex-a72
+SMP = 4
 ACCEL = 
 ifeq ($(CPU), host)
 	ACCEL = -accel hvf
@@ -11,12 +12,13 @@ endif
 
 
 ifeq ($(BOARD),aarch64-virt9)
-	QEMU_FLAGS = -machine virt -cpu $(CPU) $(ACCEL) -monitor none
+	QEMU_FLAGS = -machine virt -cpu $(CPU) -smp $(SMP) $(ACCEL) -monitor none
 	PA_ENTRY = 0x40080000
 	KA_BEGIN = 0xffffff8000000000
 	PA_UART_LOGGING = 0x09000000ull
 	GICD_BASE = 0x08000000ull
 	GICC_BASE = 0x08010000ull
+	UART_IRQ = 33
 	MEMORY_BEGIN = 0x40000000
 	MEMORY_SIZE = 0x20000000
 	BOOT_ASM = boot-virt9.s
@@ -28,6 +30,7 @@ else ifeq ($(BOARD),aarch64-raspi4b)
 	PA_UART_LOGGING = 0xFE201000ull
 	GICD_BASE = 0xff841000ull
 	GICC_BASE = 0xff842000ull
+	UART_IRQ = 153
 	MEMORY_BEGIN = 0
 	MEMORY_SIZE = 0x20000000
 	BOOT_ASM = boot-raspi4b.s
@@ -61,7 +64,7 @@ else
 	endif
 endif
 
-DEFINES += -DPA_ENTRY=$(PA_ENTRY) -DKA_BEGIN=$(KA_BEGIN) -DSIZE_PREKERNEL=$(SIZE_PREKERNEL) -DPA_UART_LOGGING=$(PA_UART_LOGGING) -DWWOS_GICC_BASE=$(GICC_BASE) -DWWOS_GICD_BASE=$(GICD_BASE) -DWWOS_MEMORY_BEGIN=$(MEMORY_BEGIN) -DWWOS_MEMORY_SIZE=$(MEMORY_SIZE)
+DEFINES += -DPA_ENTRY=$(PA_ENTRY) -DKA_BEGIN=$(KA_BEGIN) -DSIZE_PREKERNEL=$(SIZE_PREKERNEL) -DPA_UART_LOGGING=$(PA_UART_LOGGING) -DWWOS_GICC_BASE=$(GICC_BASE) -DWWOS_GICD_BASE=$(GICD_BASE) -DWWOS_UART_IRQ=$(UART_IRQ) -DWWOS_MEMORY_BEGIN=$(MEMORY_BEGIN) -DWWOS_MEMORY_SIZE=$(MEMORY_SIZE)
 
 
 CCFLAGS += -Iinclude -Wall -Werror -O2 -mgeneral-regs-only -ffreestanding -nostdlib -nostdinc -std=c++17 -fno-exceptions -fno-threadsafe-statics -fno-use-cxa-atexit -fno-rtti -funwind-tables $(DEFINES) 